@@ -0,0 +1,404 @@
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <iostream>
+#include <chrono>
+#include <OBJparser.h>
+#include <Raster.h>
+#include <Camera.h>
+#include <Meshlet.h>
+#include <DynamicResolution.h>
+#include <Occlusion.h>
+#include <MeshGen.h>
+#include <ShadowMap.h>
+#include <Object.h>
+#include <SoftwareRender.h>
+#include <random>
+
+using namespace std;
+
+
+
+// benchmarks for the software path, run without a window
+
+// quad as 2 triangles, corners given in camera space, uv repeated `tiling` times
+void drawQuad(framebuffer& fb, vec3d corners[4], float tiling, const texture* tex, bool mipmapping, rasterStats& stats) {
+    float uv[4][2] = { { 0, 0 }, { tiling, 0 }, { tiling, tiling }, { 0, tiling } };
+    rasterVertex r[4];
+    for (int i = 0; i < 4; i++) {
+        float depth = 1.0f / corners[i].z;
+        r[i].x = corners[i].x * depth * 200 + fb.width / 2;
+        r[i].y = -corners[i].y * depth * 200 + fb.height / 2;
+        r[i].invZ = depth;
+        r[i].uz = uv[i][0] * depth;
+        r[i].vz = uv[i][1] * depth;
+    }
+    rasterTriangle(fb, r[0], r[1], r[2], tex, sf::Color::White, 1.0f, mipmapping, stats);
+    rasterTriangle(fb, r[0], r[2], r[3], tex, sf::Color::White, 1.0f, mipmapping, stats);
+    stats.triangles += 2;
+}
+
+// textured pixels per second on minified surfaces, with and without mipmapping
+// a texture that fits in the cache hides the cost of level 0 reads that are far apart,
+// so it is repeated with one (256 MB) bigger than the last level cache
+void benchTexels() {
+    framebuffer fb(1600, 900);
+
+    struct surface {
+        const char* name;
+        vec3d corners[4];
+        float tiling;           // for a 2048 texture, scaled so texels per pixel do not depend on the size
+    };
+    vector<surface> surfaces = {
+        // wall facing the camera: ~80 texels per pixel
+        { "far wall", { { -10, -10, 10 }, { 10, -10, 10 }, { 10, 10, 10 }, { -10, 10, 10 } }, 16.0f },
+        // floor going to the horizon: minification grows with distance
+        { "floor", { { -60, -3, 2 }, { 60, -3, 2 }, { 60, -3, 200 }, { -60, -3, 200 } }, 32.0f },
+    };
+
+    const int frames = 50;
+    for (int size : { 512, 8192 }) {
+        texture tex = texture::checker(size, 8, sf::Color(255, 150, 150), sf::Color(90, 90, 90));
+        cout << "texture " << size << "x" << size << " (" << (size_t)size * size * 4 / (1 << 20) << " MB)\n";
+        for (auto& s : surfaces) {
+            for (bool mip : { false, true }) {
+                rasterStats stats;
+                double sec = 0.0;
+                for (int f = 0; f < frames; f++) {
+                    fb.clear(sf::Color::Black);
+                    auto start = chrono::steady_clock::now();
+                    drawQuad(fb, s.corners, s.tiling * 2048 / size, &tex, mip, stats);
+                    sec += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                }
+                cout << "  " << s.name << (mip ? " [mip]   " : " [no mip]")
+                    << "  pixels/frame " << stats.pixels / frames
+                    << "  Mtexels/s " << stats.texels / sec / 1e6
+                    << "  Mfetches/s " << stats.texels * 4 / sec / 1e6
+                    << "  ms/frame " << sec * 1000.0 / frames << "\n";
+            }
+        }
+    }
+}
+
+// camera at pos looking at target
+Camera lookAt(vec3d pos, vec3d target) {
+    Camera cam(pos);
+    vec3d d = (pos - target).normalize(); // cam looks along -front
+    cam.yaw = atan2(d.z, d.x) * 180.0f / pi;
+    cam.pitch = std::clamp(asin(d.y) * 180.0f / pi, -89.0f, 89.0f);
+    cam.updateVectors();
+    return cam;
+}
+
+// fraction of meshlets / polys culled by frustum + normal cone, seen from around the mesh
+void benchMeshletCulling() {
+    for (string path : { "Rat.obj", "Axe.obj" }) {
+        vector<vec3d> verts, norms;
+        vector<polygon> polys;
+        if (!loadOBJ(path, verts, norms, polys)) continue;
+        vector<meshlet> meshlets = buildMeshlets(verts, norms, polys);
+
+        // bounding sphere of the whole mesh
+        vec3d lo = verts[0], hi = verts[0];
+        for (auto& v : verts) {
+            lo = vec3d(min(lo.x, v.x), min(lo.y, v.y), min(lo.z, v.z));
+            hi = vec3d(max(hi.x, v.x), max(hi.y, v.y), max(hi.z, v.z));
+        }
+        vec3d center = (lo + hi) / 2;
+        float r = dist(lo, hi) / 2;
+
+        cout << path << ": " << polys.size() << " polys, " << meshlets.size() << " meshlets\n";
+        struct view {
+            const char* name;
+            vec3d pos;
+            vec3d target;
+        };
+        vector<view> views = {
+            { "front", center + vec3d(0, 0, 3 * r), center },
+            { "back", center + vec3d(0, 0, -3 * r), center },
+            { "left", center + vec3d(-3 * r, 0, 0), center },
+            { "right", center + vec3d(3 * r, 0, 0), center },
+            { "top", center + vec3d(0.01f * r, 3 * r, 0), center },
+            { "diagonal", center + vec3d(2 * r, 2 * r, 2 * r), center },
+            // the mesh is partly / fully out of the (very wide) frustum
+            { "sideways", center + vec3d(0, 0, 1.5f * r), center + vec3d(3 * r, 0, 1.5f * r) },
+            { "looking away", center + vec3d(0, 0, 1.5f * r), center + vec3d(0, 0, 5 * r) },
+        };
+        for (auto& v : views) {
+            Camera cam = lookAt(v.pos, v.target);
+            cullStats stats;
+            vector<int> visible;
+            cullMeshlets(meshlets, cam, 800.0f / 200, 450.0f / 200, visible, &stats);
+
+            // what the per-poly backface test in draw() rejects, for comparison
+            size_t backfacing = 0;
+            for (auto& p : polys) {
+                vec3d polyCenter = (verts[(int)p(0)] + verts[(int)p(1)] + verts[(int)p(2)]) / 3;
+                if (dot(meshletNormal(norms, p), (cam.pos - polyCenter).normalize()) < 0.0f) backfacing++;
+            }
+            cout << "  " << v.name << ": clusters culled " << stats.frustumCulled + stats.coneCulled << "/" << stats.meshlets
+                << " (frustum " << stats.frustumCulled << ", cone " << stats.coneCulled << ")"
+                << "  polys culled " << 100.0 * stats.trisCulled / stats.tris << "%"
+                << "  (per-poly backfacing " << 100.0 * backfacing / polys.size() << "%)\n";
+        }
+    }
+}
+
+// dynamic resolution under a synthetic load ramp:
+// frame = 2 ms fixed + load * 20 ms * scale^2 (pixel work) +-5% noise
+// false if the scale leaves its bounds, the controller misses the target more than the fixed resolution does
+// or frame time does not settle around the target in every phase of the load
+bool benchDynamicResolution() {
+    const float target = 1000.0f / 60;
+    resolutionController resolution(target, 0.25f, 1.0f);
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> noise(0.95f, 1.05f);
+
+    auto loadAt = [](int f) {
+        if (f < 100) return 0.3f;                           // light
+        if (f < 300) return 0.3f + 1.7f * (f - 100) / 200;  // ramp up
+        if (f < 400) return 2.0f;                           // heavy
+        if (f < 600) return 2.0f - 1.7f * (f - 400) / 200;  // ramp down
+        if (f < 700) return 0.3f;                           // light
+        return 2.0f;                                        // sudden heavy
+    };
+
+    const int frames = 800;
+    const int phases[] = { 0, 100, 300, 400, 600, 700, frames };
+    const int settleFrames = 30;
+    double errFixed = 0, errDynamic = 0;
+    vector<float> fixedMs, dynamicMs, scales;
+    bool ok = true;
+    cout << "dynamic resolution, target " << target << " ms\n";
+    for (int f = 0; f < frames; f++) {
+        float load = loadAt(f);
+        float n = noise(gen);
+        float fixed = (2.0f + load * 20.0f) * n;
+        float scale = resolution.scale;
+        float ms = (2.0f + load * 20.0f * scale * scale) * n;
+        resolution.update(ms);
+        if (scale < resolution.minScale || scale > resolution.maxScale) {
+            cout << "  FAIL: scale " << scale << " out of [" << resolution.minScale << ", " << resolution.maxScale << "] at frame " << f << "\n";
+            ok = false;
+        }
+
+        fixedMs.push_back(fixed);
+        dynamicMs.push_back(ms);
+        scales.push_back(scale);
+        errFixed += fabs(fixed - target);
+        errDynamic += fabs(ms - target);
+        if (f % 50 == 0)
+            cout << "  frame " << f << "  load " << load << "  scale " << scale << "  ms " << ms << " (fixed " << fixed << ")\n";
+    }
+
+    auto variance = [](const vector<float>& v) {
+        double avg = 0, ans = 0;
+        for (float x : v) avg += x;
+        avg /= v.size();
+        for (float x : v) ans += (x - avg) * (x - avg);
+        return ans / v.size();
+    };
+    cout << "  mean |ms - target|: fixed " << errFixed / frames << ", dynamic " << errDynamic / frames << "\n"
+        << "  frame time variance: fixed " << variance(fixedMs) << ", dynamic " << variance(dynamicMs) << "\n"
+        << "  scale changes " << resolution.changes << "\n";
+    if (errDynamic >= errFixed) {
+        cout << "  FAIL: dynamic resolution misses the target more than the fixed one\n";
+        ok = false;
+    }
+
+    // average of the last window frames (of the phase) is within band * deadband of the target,
+    // or it cannot get closer as scale is already at a bound
+    auto settled = [&](int start, int f, float band) {
+        int from = max(start, f + 1 - resolution.window);
+        float avg = 0;
+        for (int i = from; i <= f; i++) avg += dynamicMs[i];
+        avg /= f + 1 - from;
+        float ratio = target / avg;
+        if (ratio > 1 - band * resolution.deadband && ratio < 1 + band * resolution.deadband) return true;
+        return (avg < target && scales[f] == resolution.maxScale) || (avg > target && scales[f] == resolution.minScale);
+    };
+    // each phase: inside the deadband within settleFrames, after that (the controller lags a ramp a bit)
+    // never more than twice the deadband off
+    for (int p = 0; p + 1 < (int)size(phases); p++) {
+        int f = phases[p];
+        while (f < phases[p + 1] && !settled(phases[p], f, 1)) f++;
+        int in = f - phases[p], off = 0;
+        for (; f < phases[p + 1]; f++) off += !settled(phases[p], f, 2);
+        cout << "  phase " << phases[p] << "-" << phases[p + 1] << ": settled after " << in << " frames, off after that " << off << " frames\n";
+        if (in > settleFrames || off) {
+            cout << "  FAIL: frame time not kept around the target\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// piece of the synthetic city: a building (occluder) or a detailed prop in the streets
+// blocks x blocks buildings of random height on a grid of streets, a detailed sphere at every crossing
+// and along the streets, colors get one entry per poly
+vector<obj> buildCity(int blocks, size_t propPolys, vector<sf::Color>& colors) {
+    const float pitch = 40, street = 12;
+    mt19937 gen(7);
+    uniform_real_distribution<float> roof(20, 120);
+    vector<obj> ans;
+    colors.clear();
+
+    vector<vec3d> sv, sn, st;
+    vector<polygon> sp;
+    generateSphere(propPolys, 3.0f, sv, sn, st, sp);
+    vector<meshlet> sm = buildMeshlets(sv, sn, sp);
+
+    for (int i = 0; i < blocks; i++) {
+        for (int j = 0; j < blocks; j++) {
+            vector<vec3d> bv, bn, bt;
+            vector<polygon> bp;
+            vec3d lo(i * pitch + street / 2, 0, j * pitch + street / 2);
+            vec3d hi((i + 1) * pitch - street / 2, roof(gen), (j + 1) * pitch - street / 2);
+            appendBox(lo, hi, bv, bn, bt, bp);
+            ans.push_back(obj(bv, bn, bt, bp));
+            ans.back().occluder = true;
+            colors.insert(colors.end(), bp.size(), sf::Color(150, 150, 170));
+
+            for (vec3d at : { vec3d(i * pitch, 3, j * pitch), vec3d(i * pitch + pitch / 2, 3, j * pitch) }) {
+                ans.push_back(obj(sv, sn, st, sp));
+                ans.back().setMeshlets(sm);
+                ans.back().setPos(at.x, at.y, at.z);
+                colors.insert(colors.end(), sp.size(), sf::Color(200, 120, 60));
+            }
+        }
+    }
+    return ans;
+}
+
+// objects and clusters rejected by the occlusion stage and the frame time with / without it
+// on a dense city seen from the streets and from above, drawn by the software path of Main3D
+// (lighting cache and a static shadow map included)
+// false if culling changes a single pixel of the image
+bool benchOcclusion() {
+    vector<sf::Color> cityColors;
+    vector<obj> city = buildCity(16, 800, cityColors);
+    size_t polys = 0;
+    for (auto& o : city) polys += o.polys.size();
+    cout << "occlusion culling, city of " << city.size() << " objects, " << polys << " polys\n";
+
+    light sun({ 320, 400, 320 });
+    sun.setDensity(300);
+    shadowMap shadows(256);
+    shadows.update(city, sun.pos);
+    lightingCache lighting;
+
+    framebuffer fb(1600, 900), reference(1600, 900);
+    occlusionBuffer occlusion(fb.width / 2, fb.height / 2, 200.0f / 2);
+    struct view {
+        const char* name;
+        vec3d pos;
+        vec3d target;
+    };
+    vector<view> views = {
+        { "along a street", { 0, 4, -20 }, { 0, 4, 600 } },
+        { "street crossing", { 280, 4, 280 }, { 600, 4, 330 } },
+        { "diagonal", { -30, 10, -30 }, { 600, 10, 600 } },
+        { "above the roofs", { 320, 300, -150 }, { 320, 0, 320 } },
+    };
+
+    const int frames = 5;
+    bool ok = true;
+    for (auto& v : views) {
+        Camera cam = lookAt(v.pos, v.target);
+        double msOff = 0, msOn = 0, msOccluders = 0;
+        occlusionStats occ;
+        size_t diff = 0;
+        for (int f = 0; f < frames; f++) {
+            rasterStats stats;
+
+            // without occlusion culling
+            frameMemory.reset();
+            frameVector<sf::Color> colors(cityColors.begin(), cityColors.end());
+            auto start = chrono::steady_clock::now();
+            reference.clear(sf::Color::Black);
+            drawSceneSoftware(city, reference, cam, sun, colors, false, stats, &lighting, nullptr, nullptr, &shadows);
+            msOff += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            // with it: occluders in, pyramid, tests, then only what survived
+            frameMemory.reset();
+            frameVector<sf::Color> colorsOn(cityColors.begin(), cityColors.end());
+            start = chrono::steady_clock::now();
+            fb.clear(sf::Color::Black);
+            buildOcclusion(city, cam, occlusion);
+            msOccluders += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            drawSceneSoftware(city, fb, cam, sun, colorsOn, false, stats, &lighting, nullptr, &occlusion, &shadows);
+            msOn += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            occ = occlusion.stats;
+        }
+        for (size_t i = 0; i < fb.color.size(); i++) diff += fb.color[i] != reference.color[i];
+
+        cout << "  " << v.name << ": objects rejected " << occ.objectsCulled << "/" << occ.objects
+            << " (" << 100.0 * occ.objectsCulled / occ.objects << "%)"
+            << ", clusters " << occ.clustersCulled << "/" << occ.clusters
+            << "  | frame " << msOff / frames << " -> " << msOn / frames << " ms"
+            << " (occluders + pyramid " << msOccluders / frames << " ms, " << occ.occluderTris << " tris)"
+            << "  | pixels differing " << diff << "\n";
+        if (diff) {
+            cout << "  FAIL: occlusion culling changed the image\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// what shadowMap::update() needs of an object
+struct shadowCaster {
+    vector<vec3d> verts;
+    vector<polygon> polys;
+    int id;
+    unsigned version = 0;
+    bool castsShadow = true;
+    bool dynamic = false;
+};
+
+// cached static + dynamic layers against re-rendering every caster whenever anything moved:
+// the axe rotates every frame, the rat stands still, the light moves once in the middle
+void benchShadows() {
+    vector<shadowCaster> casters(2);
+    vector<vec3d> norms;
+    if (!loadOBJ("Axe.obj", casters[0].verts, norms, casters[0].polys)) return;
+    if (!loadOBJ("Rat.obj", casters[1].verts, norms, casters[1].polys)) return;
+    for (auto& v : casters[0].verts) v = v * 2 + vec3d(0, 100, -70);
+    for (auto& v : casters[1].verts) v = v * 100;
+    casters[0].id = 0;
+    casters[1].id = 1;
+    vec3d axeCenter(0, 100, -70);
+
+    cout << "shadow maps, axe " << casters[0].polys.size() << " polys (rotating), rat " << casters[1].polys.size() << " polys (static)\n";
+    const int frames = 120;
+    for (bool layered : { false, true }) {
+        vector<shadowCaster> scene = casters;
+        scene[0].dynamic = true;
+        // without layers everything is in the one re-rendered layer
+        scene[1].dynamic = !layered;
+        shadowMap shadows(256);
+        vec3d lightPos(50, 300, -60);
+        double ms = 0;
+        size_t tris = 0;
+        for (int f = 0; f < frames; f++) {
+            frameMemory.reset();
+            for (auto& v : scene[0].verts) v = axeCenter + (v - axeCenter).rotateVector(vec3d(0.03f, 0, 0));
+            scene[0].version++;
+            if (f == frames / 2) lightPos = lightPos + vec3d(20, 0, 0);
+            shadows.update(scene, lightPos);
+            ms += shadows.stats.ms;
+            tris += shadows.stats.tris;
+        }
+        cout << (layered ? "  static + dynamic layers" : "  one layer            ")
+            << ": renders static " << shadows.stats.staticRenders << ", dynamic " << shadows.stats.dynamicRenders
+            << " in " << frames << " frames  | pass " << ms / frames << " ms/frame, " << tris / frames << " tris/frame\n";
+    }
+}
+
+int main() {
+    benchTexels();
+    benchMeshletCulling();
+    bool ok = benchDynamicResolution();
+    ok = benchOcclusion() && ok;
+    benchShadows();
+    return ok ? 0 : 1;
+}
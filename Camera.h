@@ -0,0 +1,42 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <Math3D.h>
+
+
+
+class Camera {
+public:
+    vec3d pos;          // pos in global coords
+    vec3d front;        // local Z
+    vec3d right;        // local X
+    vec3d up;           // local Y
+    float yaw, pitch;   // rotation angles
+
+    Camera(vec3d _pos = { 3, 3, 3 }) :
+        pos(_pos), front({ 0, 0, -1 }), right({ 1, 0, 0 }), up({ 0, 1, 0 }),
+        yaw(0), pitch(0) {}
+
+    void updateVectors() {
+        front.x = cos(rad(yaw)) * cos(rad(pitch));
+        front.y = sin(rad(pitch));
+        front.z = sin(rad(yaw)) * cos(rad(pitch));
+        front = front.normalize();
+
+        right = vecProd(front, { 0, 1, 0 }).normalize();
+        up = vecProd(right, front).normalize();
+    }
+};
+
+inline vec3d applyCamera(vec3d point, Camera& cam) {
+    // get translate point to cam coords
+    vec3d translated = point - cam.pos;
+
+    // projection on axises
+    vec3d result;
+    result.x = dot(translated, cam.right);
+    result.y = dot(translated, cam.up);
+    result.z = dot(translated, cam.front * (-1));
+
+    return result;
+}
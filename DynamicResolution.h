@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+
+
+// picks the internal resolution of the software path so that frames take about targetMs
+// pixel work grows with scale^2, so the scale is corrected by sqrt(target / average frame time):
+// fast when over budget, half way when under it, nothing inside of the +-deadband
+// after every change the window is refilled at the new scale before the next decision
+class resolutionController {
+public:
+    float targetMs;             // wanted frame time
+    float minScale, maxScale;   // bounds of scale
+    float scale;                // current render scale (of both width and height)
+    int window = 8;             // frames averaged for a decision
+    float deadband = 0.1f;      // +-10% around the target is ok
+    float step = 1.0f / 32;     // scale is quantized, so it does not jitter by tiny amounts
+    size_t changes = 0;         // how many times scale was changed
+
+    resolutionController(float _targetMs = 1000.0f / 60, float _minScale = 0.25f, float _maxScale = 1.0f) :
+        targetMs(_targetMs), minScale(_minScale), maxScale(_maxScale), scale(_maxScale) {
+        history.reserve(historySize + 1);
+    }
+
+    // frame took ms at the current scale -> scale for the next frame
+    float update(float ms) {
+        recent.push_back(ms);
+        history.push_back(ms);
+        if (history.size() > historySize) history.erase(history.begin());
+        if ((int)recent.size() < window) return scale;
+
+        float avg = mean(recent);
+        recent.erase(recent.begin());
+        float ratio = targetMs / std::max(avg, 1e-3f);
+        if (ratio > 1 - deadband && ratio < 1 + deadband) return scale;
+
+        float desired = scale * sqrt(ratio);
+        float gain = ratio < 1 ? 1.0f : 0.5f;
+        float next = scale + (desired - scale) * gain;
+        next = std::round(next / step) * step;
+        next = std::clamp(next, minScale, maxScale);
+        if (next != scale) {
+            scale = next;
+            changes++;
+            recent.clear();
+        }
+        return scale;
+    }
+
+    // size of the internal buffer for the output size
+    int scaled(int size) const {
+        return std::max(1, (int)(size * scale));
+    }
+
+    // frame time stats over the last historySize frames
+    float averageMs() const {
+        return mean(history);
+    }
+
+    float varianceMs() const {
+        if (history.empty()) return 0;
+        float avg = mean(history);
+        float ans = 0;
+        for (float ms : history) ans += (ms - avg) * (ms - avg);
+        return ans / history.size();
+    }
+
+private:
+    static constexpr size_t historySize = 120;
+    // plain vectors: erasing the front never frees memory, so a running controller does not allocate
+    std::vector<float> recent;  // frames at the current scale
+    std::vector<float> history; // all recent frames
+
+    static float mean(const std::vector<float>& d) {
+        if (d.empty()) return 0;
+        float ans = 0;
+        for (float ms : d) ans += ms;
+        return ans / d.size();
+    }
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+
+
+// linear (bump) allocator for data that lives for one frame only
+// allocate() moves a pointer, deallocate does nothing, reset() at the frame end forgets everything at once
+// the memory is kept between frames: when a frame needed more than one block, the blocks are merged
+// into one big block on reset(), so steady state frames do no heap allocations at all
+class frameArena {
+public:
+    // current frame
+    size_t allocations = 0;
+    size_t bytes = 0;
+    // previous frame (what reset() saw)
+    size_t lastAllocations = 0;
+    size_t lastBytes = 0;
+    // since start
+    size_t heapAllocations = 0; // blocks taken from the heap
+    size_t peakBytes = 0;
+
+    frameArena(size_t _blockSize = 1 << 20) :
+        blockSize(_blockSize) {}
+
+    frameArena(const frameArena&) = delete;
+    frameArena& operator =(const frameArena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        allocations++;
+        bytes += size;
+        if (blocks.empty()) addBlock(std::max(blockSize, size + align));
+
+        for (;;) {
+            block& b = blocks[current];
+            uintptr_t base = reinterpret_cast<uintptr_t>(b.data.get());
+            uintptr_t p = (base + offset + align - 1) & ~(uintptr_t)(align - 1);
+            if (p + size <= base + b.size) {
+                offset = p + size - base;
+                return reinterpret_cast<void*>(p);
+            }
+            // next block, or a new one big enough
+            current++;
+            offset = 0;
+            if (current == blocks.size()) addBlock(std::max(blocks.back().size * 2, size + align));
+        }
+    }
+
+    // end of the frame, everything allocated since the last reset is gone
+    void reset() {
+        lastAllocations = allocations;
+        lastBytes = bytes;
+        peakBytes = std::max(peakBytes, bytes);
+        allocations = 0;
+        bytes = 0;
+
+        if (current > 0) {
+            // the frame did not fit into one block -> one block for all of it next time
+            size_t total = 0;
+            for (auto& b : blocks) total += b.size;
+            blocks.clear();
+            addBlock(total);
+        }
+        current = 0;
+        offset = 0;
+    }
+
+    size_t capacity() const {
+        size_t ans = 0;
+        for (auto& b : blocks) ans += b.size;
+        return ans;
+    }
+
+private:
+    struct block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+    std::vector<block> blocks;
+    size_t current = 0;         // block being filled
+    size_t offset = 0;          // first free byte in it
+    size_t blockSize;
+
+    void addBlock(size_t size) {
+        blocks.push_back({ std::unique_ptr<char[]>(new char[size]), size });
+        heapAllocations++;
+    }
+};
+
+// arena every frame-scoped container takes its memory from, reset once per frame in main()
+inline frameArena frameMemory;
+
+// std allocator interface on top of a frameArena
+template <class T>
+struct arenaAllocator {
+    using value_type = T;
+    frameArena* arena;
+
+    arenaAllocator(frameArena* _arena = &frameMemory) :
+        arena(_arena) {}
+
+    template <class U>
+    arenaAllocator(const arenaAllocator<U>& a) :
+        arena(a.arena) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {}
+};
+
+template <class T, class U>
+bool operator ==(const arenaAllocator<T>& a, const arenaAllocator<U>& b) {
+    return a.arena == b.arena;
+}
+
+template <class T, class U>
+bool operator !=(const arenaAllocator<T>& a, const arenaAllocator<U>& b) {
+    return a.arena != b.arena;
+}
+
+// vector for transient per-frame data, must not outlive the frame
+template <class T>
+using frameVector = std::vector<T, arenaAllocator<T>>;
@@ -2,21 +2,25 @@
 #include <vector>
 #include <iostream>
 #include <OBJparser.h>
+#include <Raster.h>
+#include <Camera.h>
+#include <Meshlet.h>
+#include <DynamicResolution.h>
+#include <FrameArena.h>
+#include <Occlusion.h>
+#include <ShadowMap.h>
+#include <Object.h>
+#include <SoftwareRender.h>
 #include <random>
 #include <climits>
 #include <cfloat>
+#include <cstdio>
+#include <unordered_map>
 
 using namespace std;
 
 
 
-constexpr int width = 1600;
-constexpr int height = 900;
-constexpr int centerX = width / 2;
-constexpr int centerY = height / 2;
-
-
-
 // random gen
 float getRandom(float rangeMin, float rangeMax) {
     std::default_random_engine gen(std::random_device{}());
@@ -29,315 +33,35 @@ sf::Color getRandomColor(sf::Color c1, sf::Color c2) {
     return r > 50 ? c1 : c2;
 }
 
-float rad(float deg) {
-    return deg * pi / 180.0f;
-}
-
-float dot(vec3d a, vec3d b) {
-    return a.x * b.x + a.y * b.y + a.z * b.z;
-}
-
-vec3d vecProd(vec3d a, vec3d b) {
-    vec3d ans;
-    ans.x = a.y * b.z - a.z * b.y;
-    ans.y = a.z * b.x - a.x * b.z;
-    ans.z = a.x * b.y - a.y * b.z;
-    return ans;
-}
-
-float cosVecAngle(vec3d a, vec3d b) { // get cos of the angle between 2 vectors
-    float lenA = a.normEuc();
-    float lenB = b.normEuc();
-
-    float cosTheta = dot(a, b) / (lenA * lenB);
-
-    // limit cosTheta vals
-    cosTheta = max(-1.0f, min(1.0f, cosTheta));
-
-    return cosTheta;
-}
-
-float dist(vec3d a, vec3d b) {
-    return sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y) + (b.z - a.z) * (b.z - a.z));
-}
-
-class Camera {
-public:
-    vec3d pos;          // pos in global coords
-    vec3d front;        // local Z
-    vec3d right;        // local X
-    vec3d up;           // local Y
-    float yaw, pitch;   // rotation angles
-
-    Camera(vec3d _pos = { 3, 3, 3 }) :
-        pos(_pos), front({ 0, 0, -1 }), right({ 1, 0, 0 }), up({ 0, 1, 0 }),
-        yaw(0), pitch(0) {}
-
-    void updateVectors() {
-        front.x = cos(rad(yaw)) * cos(rad(pitch));
-        front.y = sin(rad(pitch));
-        front.z = sin(rad(yaw)) * cos(rad(pitch));
-        front = front.normalize();
-
-        right = vecProd(front, { 0, 1, 0 }).normalize();
-        up = vecProd(right, front).normalize();
-    }
+// merged geometry of the visible polys of a frame, lives in the frame arena
+struct sceneMesh {
+    frameVector<vec3d> verts;
+    frameVector<vec3d> norms;
+    frameVector<polygon> polys;
 };
 
-vec3d applyCamera(vec3d point, Camera& cam) {
-    // get translate point to cam coords
-    vec3d translated = point - cam.pos;
-
-    // projection on axises
-    vec3d result;
-    result.x = dot(translated, cam.right);
-    result.y = dot(translated, cam.up);
-    result.z = dot(translated, cam.front * (-1));
-
-    return result;
-}
-
-class obj {
-public:
-    vector<vec3d> verts;        // vertices
-    vector<vec3d> norms;        // normals
-    vector<polygon> polys;      // polygons
-    vec3d pos;                  // center pos
-    vec3d front;                // local Z
-    vec3d right;                // local X
-    vec3d up;                   // local Y
-    float mass;                 // mass
-    vec3d vel;                  // velocity
-    vec3d acc;                  // acceleration
-    vec3d angVel;               // angular velocity
-    vec3d angAcc;               // angular acceleration
-    float scale;                // scale multiplier
-
-    obj(vector<vec3d> _verts, vector<vec3d> _norms, vector<polygon> _polys, float _mass = 0, float _scale = 1) :
-        verts(_verts), norms(_norms), polys(_polys), mass(_mass), scale(_scale), front({ 0, 0, -1 }), right({ 1, 0, 0 }), up({ 0, 1, 0 }) {
-        setupPos(); setupScale();
-    }
-
-    void setupPos() {
-        float c = 0.0f;
-        for (auto& v : verts) {
-            pos.x += v.x;
-            pos.y += v.y;
-            pos.z += v.z;
-            c++;
-        }
-        pos.x /= c;
-        pos.y /= c;
-        pos.z /= c;
-    }
-
-    void setupScale() {
-        pos = pos * scale;
-        for (auto& v : verts) {
-            v.x *= scale;
-            v.y *= scale;
-            v.z *= scale;
-        }
-    }
-
-    void setPos(float x, float y, float z) {
-        vec3d posOld = pos;
-        for (auto& v : verts) {
-            pos.x = x;
-            pos.y = y;
-            pos.z = z;
-            v = v + pos - posOld;
-        }
-    }
-
-    // move object (ignoring normals cause why should not we)
-    void moveForward(float a) {
-        pos = pos - front * a;
-        for (auto& v : verts) {
-            v = v - front * a;
-        }
-    }
-    void moveBackward(float a) {
-        pos = pos + front * a;
-        for (auto& v : verts) {
-            v = v + front * a;
-        }
-    }
-    void moveRight(float a) {
-        pos = pos + right * a;
-        for (auto& v : verts) {
-            v = v + right * a;
-        }
-    }
-    void moveLeft(float a) {
-        pos = pos - right * a;
-        for (auto& v : verts) {
-            v = v - right * a;
-        }
-    }
-    void moveUp(float a) {
-        pos = pos + up * a;
-        for (auto& v : verts) {
-            v = v + up * a;
-        }
-    }
-    void moveDown(float a) {
-        pos = pos - up * a;
-        for (auto& v : verts) {
-            v = v - up * a;
-        }
-    }
-
-    // GLOBAL
-    void moveUpGlobal(float a) {
-        pos.y += a;
-        for (auto& v : verts) {
-            v.y = v.y + a;
-        }
-    }
-    void moveDownGlobal(float a) {
-        pos.y -= a;
-        for (auto& v : verts) {
-            v.y = v.y - a;
-        }
-    }
-
-    void movecustom(vec3d& vec, float a) {
-        pos = pos - vec * a;
-        for (auto& v : verts) {
-            v = v - vec * a;
-        }
+// shades != nullptr -> precomputed lambert factors for o.polys, 0 in shadow (see lightingCache)
+template <class Mesh>
+void draw(sf::RenderWindow& w, Mesh& o, Camera& cam, light& sun, const frameVector<sf::Color>& colors, const frameVector<float>* shades = nullptr) {
+    frameVector<sf::Vector2f> projections;
+    frameVector<float> depths; // vector for sorting
+    projections.reserve(o.verts.size());
+    depths.reserve(o.verts.size());
+
+    // verts of culled meshlets are not in any poly, no need to transform them
+    frameVector<char> used(o.verts.size(), 0);
+    for (auto& p : o.polys) {
+        used[p(0)] = used[p(1)] = used[p(2)] = 1;
     }
 
-    void rotate(vec3d ang) { // rotate object
-        vec3d center = pos; // object center
-
-        // rotate around center
-        for (auto& v : verts) {
-            // get local coords of v
-            vec3d local = v - center;
-
-            // apply rotation
-            local = local.rotateVector(ang);
-
-            // get global coords of rotated v
-            v = center + local;
-        }
-
-        // rotate normals
-        for (auto& n : norms) {
-            n = n.rotateVector(ang);
-        }
-
-        // update local axises
-        front = front.rotateVector(ang).normalize();
-        right = right.rotateVector(ang).normalize();
-        up = up.rotateVector(ang).normalize();
-    }
-
-    void rotateAroundLocalFront(float angle) {
-        vec3d ang = front * -angle;
-
-        vec3d center = pos; // object center
-
-        // rotate around center
-        for (auto& v : verts) {
-            // get local coords of v
-            vec3d local = v - center;
-
-            // apply rotation
-            local = local.rotateVector(ang);
-
-            // get global coords of rotated v
-            v = center + local;
-        }
-
-        // rotate normals
-        for (auto& n : norms) {
-            n = n.rotateVector(ang);
-        }
-
-        // update local axises
-        front = front.rotateVector(ang).normalize();
-        right = right.rotateVector(ang).normalize();
-        up = up.rotateVector(ang).normalize();
-    }
-
-    void rotateCustom(vec3d ang, vec3d point) {
-        vec3d center = point;
-
-        // rotate around point
-        for (auto& v : verts) {
-            // get local coords of v
-            vec3d local = v - center;
-
-            // apply rotation
-            local = local.rotateVector(ang);
-
-            // get global coords of rotated v
-            v = center + local;
-        }
-
-        // rotate normals
-        for (auto& n : norms) {
-            n = n.rotateVector(ang);
-        }
-
-        // update local axises
-        front = front.rotateVector(ang).normalize();
-        right = right.rotateVector(ang).normalize();
-        up = up.rotateVector(ang).normalize();
-    }
-    //void draw(sf::RenderWindow& w, Camera& cam, vector<sf::Color> colors);
-};
-
-class light {
-public:
-    vec3d pos; // center pos
-    vec3d front; // local Z
-    vec3d right; // local X
-    vec3d up; // local Y
-    float density = 100;
-
-    light(vec3d _pos) :
-        pos(_pos), front({ 0, 0, -1 }), right({ 1, 0, 0 }), up({ 0, 1, 0 }) {}
-
-    void setPos(float x, float y, float z) {
-        vec3d p = { x, y, z };
-        pos = p;
-    }
-
-    void setDensity(float d) {
-        density = d;
-    }
-
-    // move light
-    void moveForward(float a) {
-        pos = pos - front * a;
-    }
-    void moveBackward(float a) {
-        pos = pos + front * a;
-    }
-    void moveRight(float a) {
-        pos = pos + right * a;
-    }
-    void moveLeft(float a) {
-        pos = pos - right * a;
-    }
-    void moveUp(float a) {
-        pos = pos + up * a;
-    }
-    void moveDown(float a) {
-        pos = pos - up * a;
-    }
-};
-
-void draw(sf::RenderWindow& w, obj& o, Camera& cam, light& sun, vector<sf::Color> colors) {
-    std::vector<sf::Vector2f> projections;
-    std::vector<float> depths; // vector for sorting
-
     // verts and norms translation
     for (size_t i = 0; i < o.verts.size(); ++i) {
+        if (!used[i]) {
+            projections.emplace_back(-1000, -1000);
+            depths.push_back(FLT_MAX);
+            continue;
+        }
+
         // apply cam transformation to verts
         vec3d v = o.verts[i];
 
@@ -359,7 +83,8 @@ void draw(sf::RenderWindow& w, obj& o, Camera& cam, light& sun, vector<sf::Color
     }
 
     // get all polys to the pairs with idxes
-    vector<pair<float, size_t>> sortedPolys;
+    frameVector<pair<float, size_t>> sortedPolys;
+    sortedPolys.reserve(o.polys.size());
     for (size_t i = 0; i < o.polys.size(); i++) {
         auto& p = o.polys[i];
         p.color = colors[i];
@@ -371,6 +96,7 @@ void draw(sf::RenderWindow& w, obj& o, Camera& cam, light& sun, vector<sf::Color
         [](auto& a, auto& b) { return a.first > b.first; });
 
     // drawing polys
+    static sf::ConvexShape triangle(3); // reused, a new shape per poly allocates every time
     for (const auto& [depth, i] : sortedPolys) {
         auto& p = o.polys[i];
 
@@ -385,20 +111,19 @@ void draw(sf::RenderWindow& w, obj& o, Camera& cam, light& sun, vector<sf::Color
         // vector from poly to cam
         vec3d polyCenter = (o.verts[p(0)] + o.verts[p(1)] + o.verts[p(2)]) / 3;
         vec3d viewDir = (cam.pos - polyCenter).normalize();
-        vec3d lightDir = (sun.pos - polyCenter).normalize();
 
         // checking visibility through normal
         if (dot(normal, viewDir) >= 0.0f) {
-            sf::ConvexShape triangle(3);
             triangle.setPoint(0, projections[p(0)]);
             triangle.setPoint(1, projections[p(1)]);
             triangle.setPoint(2, projections[p(2)]);
 
-            if (dot(normal, lightDir) < 0.0f) triangle.setFillColor(sf::Color(0, 0, 0));
+            float shade = shades ? (*shades)[i] : lambert(o, p, sun);
+            if (shade <= 0.0f) triangle.setFillColor(sf::Color(0, 0, 0));
             else {
-                float r = p.color.r * cosVecAngle(normal, lightDir) * sun.density / dist(sun.pos, polyCenter);
-                float g = p.color.g * cosVecAngle(normal, lightDir) * sun.density / dist(sun.pos, polyCenter);
-                float b = p.color.b * cosVecAngle(normal, lightDir) * sun.density / dist(sun.pos, polyCenter);
+                float r = p.color.r * shade;
+                float g = p.color.g * shade;
+                float b = p.color.b * shade;
                 if (r > 255) r = 255;
                 if (g > 255) g = 255;
                 if (b > 255) b = 255;
@@ -412,7 +137,8 @@ void draw(sf::RenderWindow& w, obj& o, Camera& cam, light& sun, vector<sf::Color
     }
 }
 
-void drawScene(const std::vector<obj>& objects, sf::RenderWindow& w, Camera& cam, light& sun, const std::vector<sf::Color>& colors) {
+void drawScene(std::vector<obj>& objects, sf::RenderWindow& w, Camera& cam, light& sun, const frameVector<sf::Color>& colors, lightingCache* cache = nullptr,
+    cullStats* culling = nullptr, const occlusionBuffer* occlusion = nullptr, const shadowMap* shadows = nullptr) {
     if (objects.empty()) return;
     // counting all verts, norms, polys
     size_t totalVerts = 0;
@@ -424,28 +150,53 @@ void drawScene(const std::vector<obj>& objects, sf::RenderWindow& w, Camera& cam
         totalPolys += o.polys.size();
     }
 
-    // reserving mem
-    std::vector<vec3d> V;
-    std::vector<vec3d> N;
-    std::vector<polygon> P;
-    std::vector<sf::Color> C;
+    // reserving mem (in the frame arena)
+    sceneMesh scene;
+    frameVector<vec3d>& V = scene.verts;
+    frameVector<vec3d>& N = scene.norms;
+    frameVector<polygon>& P = scene.polys;
+    frameVector<sf::Color> C;
+    frameVector<float> S;
     V.reserve(totalVerts);
     N.reserve(totalNorms);
     P.reserve(totalPolys);
     C.reserve(totalPolys);
+    if (cache || shadows) S.reserve(totalPolys);
 
     // counters
     int prevVertsCount = 0;
     int prevNormsCount = 0;
     size_t globalPolyIdx = 0; // global polygon idx
+    frameVector<int> visible;
+
+    for (auto& o : objects) {
+        // hidden objects are not merged at all
+        if (objectOccluded(o, occlusion)) {
+            globalPolyIdx += o.polys.size();
+            continue;
+        }
+
+        // whole clusters culled before merging
+        visiblePolys(o, cam, (float)centerX / 200, (float)centerY / 200, visible, culling, occlusion);
+
+        // lighting with shadows from the cache (per object, before merging), or looked up every frame without it
+        if (cache) {
+            const vector<float>& shades = cache->shade(o, sun, colors, globalPolyIdx, shadows);
+            for (int i : visible) S.push_back(shades[i]);
+        }
+        else if (shadows) {
+            for (int i : visible) {
+                float shade = lambert(o, o.polys[i], sun);
+                S.push_back(shade > 0.0f && !inLight(o, o.polys[i], shadows) ? 0.0f : shade);
+            }
+        }
 
-    for (const auto& o : objects) {
         // collecting verts and norms all together
         V.insert(V.end(), o.verts.begin(), o.verts.end());
         N.insert(N.end(), o.norms.begin(), o.norms.end());
 
         // drawing polys of the current obj
-        for (size_t localPolyIdx = 0; localPolyIdx < o.polys.size(); localPolyIdx++) {
+        for (int localPolyIdx : visible) {
             const auto& p = o.polys[localPolyIdx];
             P.emplace_back(
                 p.v.x + prevVertsCount,
@@ -457,9 +208,9 @@ void drawScene(const std::vector<obj>& objects, sf::RenderWindow& w, Camera& cam
             );
 
             // accessing color for current poly via global idx
-            C.push_back(colors[globalPolyIdx]);
-            globalPolyIdx++;
+            C.push_back(colors[globalPolyIdx + localPolyIdx]);
         }
+        globalPolyIdx += o.polys.size();
 
         // counters++
         prevVertsCount += o.verts.size();
@@ -467,8 +218,153 @@ void drawScene(const std::vector<obj>& objects, sf::RenderWindow& w, Camera& cam
     }
 
     // drawing scene
-    obj scene(V, N, P);
-    draw(w, scene, cam, sun, C);
+    draw(w, scene, cam, sun, C, cache || shadows ? &S : nullptr);
+}
+
+// decides what the software path has to redraw on the persistent framebuffer
+// camera still -> only tiles under the old and new screen bounds of transformed objects are redrawn,
+// plus, with shadows, the objects that a moved dynamic caster can shadow at its old or new place
+// anything global (camera, light, colors, fb size, invalidate()) -> full redraw
+class dirtyTracker {
+public:
+    tileGrid tiles;
+    vector<rect> rects;         // disjoint dirty rects of the current frame
+    bool full = true;           // current frame is a full redraw
+    size_t pixels = 0;          // pixels in the redrawn area of the current frame
+
+    void invalidate() {
+        forceFull = true;
+    }
+
+    void update(vector<obj>& objects, Camera& cam, light& sun, const frameVector<sf::Color>& colors, const framebuffer& fb,
+        const shadowMap* shadows = nullptr) {
+        bool sameColors = colors.size() == lastColors.size() && std::equal(colors.begin(), colors.end(), lastColors.begin());
+        full = forceFull || fb.width != tiles.width || fb.height != tiles.height ||
+            !(cam.pos == camPos) || cam.yaw != camYaw || cam.pitch != camPitch ||
+            !(sun.pos == lightPos) || sun.density != lightDensity || !sameColors;
+        forceFull = false;
+        frame++;
+        camPos = cam.pos;
+        camYaw = cam.yaw;
+        camPitch = cam.pitch;
+        lightPos = sun.pos;
+        lightDensity = sun.density;
+        if (!sameColors) lastColors.assign(colors.begin(), colors.end());
+        if (tiles.width != fb.width || tiles.height != fb.height) tiles.resize(fb.width, fb.height);
+        tiles.clear();
+        rects.clear();
+
+        if (full) {
+            // bounds come from the full redraw itself (setBounds()), objects that are gone are dropped next time
+            rects.push_back(rect(0, 0, fb.width, fb.height));
+            pixels = rects[0].area();
+            return;
+        }
+
+        // old + new bounds of what moved (states are updated in place, the map allocates only for new objects)
+        // and where moved dynamic casters were / are, their shadows moved with them
+        frameVector<sphere> casters;
+        for (auto& o : objects) {
+            auto it = states.find(o.id);
+            if (it != states.end() && it->second.version == o.version) {
+                it->second.seen = frame;
+                continue;
+            }
+            rect bounds = screenBounds(o, cam, fb);
+            if (it != states.end()) {
+                tiles.mark(it->second.bounds);
+                if (it->second.dynamicCaster) casters.push_back(it->second.world);
+            }
+            tiles.mark(bounds);
+            state& st = states[o.id];
+            st = makeState(o, bounds);
+            if (st.dynamicCaster) casters.push_back(st.world);
+        }
+        // objects that are gone
+        for (auto it = states.begin(); it != states.end();) {
+            if (it->second.seen == frame) {
+                ++it;
+                continue;
+            }
+            tiles.mark(it->second.bounds);
+            if (it->second.dynamicCaster) casters.push_back(it->second.world);
+            it = states.erase(it);
+        }
+        // static casters and the light are covered by the full redraw (layer re-rendered -> invalidate())
+        if (shadows) {
+            for (auto& c : casters) {
+                for (auto& [id, st] : states) {
+                    if (mayBeShadowed(sun.pos, c.center, c.radius, st.world.center, st.world.radius)) tiles.mark(st.bounds);
+                }
+            }
+        }
+
+        tiles.rects(rects);
+        pixels = 0;
+        for (auto& r : rects) pixels += r.area();
+    }
+
+    void setBounds(obj& o, rect bounds) {
+        states[o.id] = makeState(o, bounds);
+    }
+
+    // o has to be redrawn into one of the dirty rects
+    bool touches(const obj& o) const {
+        if (full) return true;
+        auto it = states.find(o.id);
+        if (it == states.end()) return true;
+        for (auto& r : rects) {
+            if (it->second.bounds.overlaps(r)) return true;
+        }
+        return false;
+    }
+
+private:
+    struct sphere {
+        vec3d center;
+        float radius = 0;
+    };
+    struct state {
+        unsigned version;
+        rect bounds;
+        size_t seen;            // last frame the object was in the scene
+        sphere world;           // global bounding sphere
+        bool dynamicCaster;     // in the dynamic shadow layer
+    };
+    unordered_map<int, state> states;
+
+    state makeState(obj& o, rect bounds) const {
+        vec3d lo, hi;
+        worldBounds(o, lo, hi);
+        sphere world = { (lo + hi) / 2, o.verts.empty() ? 0.0f : dist(lo, hi) / 2 };
+        return { o.version, bounds, frame, world, o.castsShadow && o.dynamic };
+    }
+    bool forceFull = true;
+    size_t frame = 0;
+    vec3d camPos, lightPos;
+    float camYaw = 0, camPitch = 0, lightDensity = 0;
+    vector<sf::Color> lastColors;
+};
+
+// software path on a persistent fb: clears and redraws only the dirty rects
+void drawSceneDirty(std::vector<obj>& objects, framebuffer& fb, Camera& cam, light& sun, const frameVector<sf::Color>& colors, sf::Color background,
+    bool mipmapping, rasterStats& stats, lightingCache* cache, dirtyTracker& dirty, cullStats* culling = nullptr,
+    const occlusionBuffer* occlusion = nullptr, const shadowMap* shadows = nullptr) {
+    dirty.update(objects, cam, sun, colors, fb, shadows);
+    for (auto& r : dirty.rects) fb.clear(background, r);
+
+    // every object is culled, transformed and shaded once, its triangles go to each dirty rect they overlap
+    size_t globalPolyIdx = 0;
+    for (auto& o : objects) {
+        if (dirty.touches(o)) {
+            rect bounds;
+            drawSoftware(fb, o, cam, sun, colors, globalPolyIdx, mipmapping, stats, cache, dirty.full ? &bounds : nullptr,
+                culling, occlusion, shadows, &dirty.rects);
+            if (dirty.full) dirty.setBounds(o, bounds);
+        }
+        globalPolyIdx += o.polys.size();
+    }
+    fb.resetScissor();
 }
 
 int main() {
@@ -477,23 +373,77 @@ int main() {
 
     vector<vec3d> vAxe;
     vector<vec3d> nAxe;
+    vector<vec3d> tAxe;
     vector<polygon> pAxe;
 
     vector<vec3d> vRat;
     vector<vec3d> nRat;
+    vector<vec3d> tRat;
     vector<polygon> pRat;
 
     vector<vec3d> vCube;
     vector<vec3d> nCube;
     vector<polygon> pCube;
 
-    loadOBJ("Axe.obj", vAxe, nAxe, pAxe);
-    loadOBJ("Rat.obj", vRat, nRat, pRat);
+    loadOBJ("Axe.obj", vAxe, nAxe, tAxe, pAxe);
+    loadOBJ("Rat.obj", vRat, nRat, tRat, pRat);
     loadOBJ("cube.obj", vCube, nCube, pCube);
 
-    obj axe(vAxe, nAxe, pAxe, 0, 2);
-    obj rat(vRat, nRat, pRat, 0, 100);
-    obj cube(vCube, nCube, pCube, 0, 2);
+    // poly clusters, cached in <model>.meshlets
+    vector<meshlet> mAxe = loadOrBuildMeshlets("Axe.obj", vAxe, nAxe, pAxe);
+    vector<meshlet> mRat = loadOrBuildMeshlets("Rat.obj", vRat, nRat, pRat);
+
+    // objects live for the whole run, the frame loop transforms and draws them in place
+    vector<obj> OBJS = {
+        obj(vAxe, nAxe, tAxe, pAxe, 0, 2),
+        obj(vRat, nRat, tRat, pRat, 0, 100),
+        obj(vCube, nCube, pCube, 0, 2)
+    };
+    obj& axe = OBJS[0];
+    obj& rat = OBJS[1];
+    obj& cube = OBJS[2];
+    axe.setMeshlets(mAxe);
+    rat.setMeshlets(mRat);
+
+    // textures (checkerboard if there is no image next to the model)
+    texture axeTex, ratTex;
+    if (!axeTex.loadFromFile("Axe.png")) axeTex = texture::checker(256, 16, sf::Color(255, 150, 150), sf::Color(120, 60, 60));
+    if (!ratTex.loadFromFile("Rat.png")) ratTex = texture::checker(512, 32, sf::Color(90, 90, 90), sf::Color(200, 200, 200));
+    axe.tex = &axeTex;
+    rat.tex = &ratTex;
+    cube.occluder = true;
+    cube.castsShadow = false;   // the light sits inside of it
+    axe.dynamic = true;         // rotates every frame, the rat's shadow layer stays cached
+
+    // software path: T - toggle, M - mipmapping on/off, R - dynamic resolution on/off, O - occlusion culling on/off, H - shadows on/off
+    framebuffer fb(width, height);
+    sf::Texture screenTex;
+    screenTex.create(width, height);
+    screenTex.setSmooth(true); // bilinear upscale of the internal resolution
+    sf::Sprite screen(screenTex);
+    bool software = false;
+    bool mipmapping = true;
+
+    // internal resolution of the software path follows the frame time (60 fps target, 25%..100% of the window)
+    resolutionController resolution(1000.0f / 60, 0.25f, 1.0f);
+    bool dynamicRes = true;
+    sf::Clock frameClock;
+
+    // objects and clusters hidden behind the occluders are skipped (depth buffer at 1/2 of the window)
+    occlusionBuffer occlusion(width / 2, height / 2, 200.0f / 2);
+    bool occlusionCulling = true;
+
+    // cube shadow map of LIGHT, static and dynamic casters in separate cached layers
+    shadowMap shadows(256);
+    bool shadowsOn = true;
+
+    // lighting is reshaded only for what changed, stats go to the title
+    lightingCache lighting;
+    char title[512];
+    size_t frame = 0;
+
+    // software path redraws only what changed while the camera stays still
+    dirtyTracker dirty;
 
     // cam
     Camera cam{ {50, 100, 50} };
@@ -525,10 +475,22 @@ int main() {
     cube.setPos(50, 100, 50);
 
     while (window.isOpen()) {
+        frameClock.restart();
+        // everything transient of the previous frame is gone at once
+        frameMemory.reset();
+        frame++;
         sf::Event event;
         while (window.pollEvent(event)) {
             if (event.type == sf::Event::Closed)
                 window.close();
+            if (event.type == sf::Event::KeyPressed) {
+                if (event.key.code == sf::Keyboard::T) software = !software;
+                if (event.key.code == sf::Keyboard::M) mipmapping = !mipmapping;
+                if (event.key.code == sf::Keyboard::R) dynamicRes = !dynamicRes;
+                if (event.key.code == sf::Keyboard::O) occlusionCulling = !occlusionCulling;
+                if (event.key.code == sf::Keyboard::H) shadowsOn = !shadowsOn;
+                dirty.invalidate();
+            }
         }
 
         x += 0.05f;
@@ -544,12 +506,15 @@ int main() {
         //color0.g = 2 * color0.r;
         //color0.b = 3 * color0.g;
 
-        vector<sf::Color> cAxe;
-        vector<sf::Color> cRat;
-        vector<sf::Color> cCube;
-
-        vector<sf::Color> colors;
+        frameVector<sf::Color> cAxe;
+        frameVector<sf::Color> cRat;
+        frameVector<sf::Color> cCube;
 
+        frameVector<sf::Color> colors;
+        cAxe.reserve(pAxe.size());
+        cRat.reserve(pRat.size());
+        cCube.reserve(pCube.size());
+        colors.reserve(pAxe.size() + pRat.size() + pCube.size());
 
         for (int i = 0; i < pAxe.size(); i++) {
             cAxe.push_back(color0);
@@ -656,9 +621,55 @@ int main() {
         lastMousePos = mousePos;
         window.clear(sf::Color::Green);
 
-        vector<obj> OBJS = { axe, rat, cube };
-
-        drawScene(OBJS, window, cam, LIGHT, colors);
+        lighting.newFrame();
+        cullStats culling;
+        if (occlusionCulling) buildOcclusion(OBJS, cam, occlusion);
+        const occlusionBuffer* occluders = occlusionCulling ? &occlusion : nullptr;
+        if (shadowsOn) {
+            shadows.update(OBJS, LIGHT.pos);
+            // the static layer is re-rendered when the light or a static caster moved, shadows may change anywhere
+            // (moved dynamic casters only dirty what they can shadow, see dirtyTracker)
+            if (shadows.stats.staticRendered) dirty.invalidate();
+        }
+        const shadowMap* shadowing = shadowsOn ? &shadows : nullptr;
+        int len = snprintf(title, sizeof(title), "UE 6");
+        if (software) {
+            // internal resolution for this frame, upscaled to the window by the sprite
+            int fbW = dynamicRes ? resolution.scaled(width) : width;
+            int fbH = dynamicRes ? resolution.scaled(height) : height;
+            if (fb.width != fbW || fb.height != fbH) fb.resize(fbW, fbH);
+
+            rasterStats stats;
+            drawSceneDirty(OBJS, fb, cam, LIGHT, colors, sf::Color::Green, mipmapping, stats, &lighting, dirty, &culling, occluders, shadowing);
+            // the texture is exactly fb sized: with a bigger one bilinear filtering at the right / bottom edge
+            // would blend in stale texels past the fb
+            if (screenTex.getSize() != sf::Vector2u(fb.width, fb.height)) {
+                screenTex.create(fb.width, fb.height);
+                screen.setTexture(screenTex, true);
+            }
+            screenTex.update(fb.pixels(), fb.width, fb.height, 0, 0);
+            screen.setScale((float)width / fb.width, (float)height / fb.height);
+            window.draw(screen);
+            len += snprintf(title + len, sizeof(title) - len, " | redrawn px %zu%s | tris %zu | res %dx%d | frame %f ms, var %f",
+                dirty.pixels, dirty.full ? " (full)" : "", stats.triangles, fb.width, fb.height,
+                resolution.averageMs(), resolution.varianceMs());
+        }
+        else drawScene(OBJS, window, cam, LIGHT, colors, &lighting, &culling, occluders, shadowing);
+        if (shadowsOn) {
+            len += snprintf(title + len, sizeof(title) - len, " | shadow maps rendered: static %zu, dynamic %zu in %zu frames, pass %.2f ms, %zu lookups",
+                shadows.stats.staticRenders, shadows.stats.dynamicRenders, shadows.stats.frames, shadows.stats.ms, shadows.stats.lookups);
+        }
+        if (occlusionCulling) {
+            len += snprintf(title + len, sizeof(title) - len, " | occluded objs %zu/%zu, clusters %zu/%zu",
+                occlusion.stats.objectsCulled, occlusion.stats.objects, occlusion.stats.clustersCulled, occlusion.stats.clusters);
+        }
+        len += snprintf(title + len, sizeof(title) - len, " | clusters culled %zu/%zu | reshaded %zu | light cache hits %d%%",
+            culling.frustumCulled + culling.coneCulled, culling.meshlets, lighting.reshaded, (int)(lighting.hitRate() * 100));
+        snprintf(title + len, sizeof(title) - len, " | frame arena %zu allocs, %zu KB",
+            frameMemory.lastAllocations, frameMemory.lastBytes / 1024);
+
+        // setTitle() allocates inside of SFML, twice a second is enough
+        if (frame % 30 == 1) window.setTitle(title);
 
         //vec3d ang(0.0, 0.1, 0.0);
 
@@ -666,6 +677,9 @@ int main() {
         //axe.draw(window, cam, cAxe);
         //rat.draw(window, cam, sf::Color(255, 255, 255));
 
+        // frame time without the framerate limit wait in display()
+        if (software && dynamicRes) resolution.update(frameClock.getElapsedTime().asMicroseconds() / 1000.0f);
+
         window.display();
     }
     return 0;
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <OBJparser.h>
+
+
+
+inline float rad(float deg) {
+    return deg * pi / 180.0f;
+}
+
+inline float dot(vec3d a, vec3d b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline vec3d vecProd(vec3d a, vec3d b) {
+    vec3d ans;
+    ans.x = a.y * b.z - a.z * b.y;
+    ans.y = a.z * b.x - a.x * b.z;
+    ans.z = a.x * b.y - a.y * b.z;
+    return ans;
+}
+
+inline float cosVecAngle(vec3d a, vec3d b) { // get cos of the angle between 2 vectors
+    float lenA = a.normEuc();
+    float lenB = b.normEuc();
+
+    float cosTheta = dot(a, b) / (lenA * lenB);
+
+    // limit cosTheta vals
+    cosTheta = std::max(-1.0f, std::min(1.0f, cosTheta));
+
+    return cosTheta;
+}
+
+inline float dist(vec3d a, vec3d b) {
+    return sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y) + (b.z - a.z) * (b.z - a.z));
+}
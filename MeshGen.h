@@ -0,0 +1,100 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <OBJparser.h>
+
+
+
+// procedural meshes, so benchmarks are not limited to the size of the bundled models
+
+// uv sphere of the given radius around the origin: rings x segments quads, each split into 2 polys
+// one normal per poly (the renderer reads only vn.x), uvs wrap once around
+inline void generateSphere(int rings, int segments, float radius,
+    std::vector<vec3d>& verts, std::vector<vec3d>& norms, std::vector<vec3d>& uvs, std::vector<polygon>& polys) {
+    verts.clear();
+    norms.clear();
+    uvs.clear();
+    polys.clear();
+    for (int r = 0; r <= rings; r++) {
+        float theta = pi * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float phi = 2 * pi * s / segments;
+            verts.emplace_back(radius * sin(theta) * cos(phi), radius * cos(theta), radius * sin(theta) * sin(phi));
+            uvs.emplace_back((float)s / segments, 1.0f - (float)r / rings, 0);
+        }
+    }
+
+    auto addPoly = [&](int a, int b, int c) {
+        vec3d center = (verts[a] + verts[b] + verts[c]) / 3;
+        norms.push_back(center.normalize());
+        int n = norms.size() - 1;
+        polys.emplace_back(a, b, c, n, n, n, a, b, c);
+    };
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            int a = r * (segments + 1) + s;
+            int b = a + segments + 1;
+            // outward winding, degenerate polys at the poles are skipped
+            if (r > 0) addPoly(a, a + 1, b);
+            if (r < rings - 1) addPoly(a + 1, b + 1, b);
+        }
+    }
+}
+
+// sphere with about `polyCount` polys
+inline void generateSphere(size_t polyCount, float radius,
+    std::vector<vec3d>& verts, std::vector<vec3d>& norms, std::vector<vec3d>& uvs, std::vector<polygon>& polys) {
+    int rings = std::max(2, (int)sqrt(polyCount / 4.0));
+    generateSphere(rings, 2 * rings, radius, verts, norms, uvs, polys);
+}
+
+// writes the mesh as .obj with "f v/vt/vn" faces (what loadOBJ() reads back)
+inline bool saveOBJ(const std::string& path, const std::vector<vec3d>& verts, const std::vector<vec3d>& norms,
+    const std::vector<vec3d>& uvs, std::vector<polygon>& polys) {
+    std::ofstream file(path);
+    if (!file.is_open()) return false;
+    file.precision(7);
+    for (auto& v : verts) file << "v " << v.x << " " << v.y << " " << v.z << "\n";
+    for (auto& t : uvs) file << "vt " << t.x << " " << t.y << "\n";
+    for (auto& n : norms) file << "vn " << n.x << " " << n.y << " " << n.z << "\n";
+    for (auto& p : polys) {
+        file << "f";
+        int t[3] = { (int)p.vt.x, (int)p.vt.y, (int)p.vt.z };
+        int n[3] = { (int)p.vn.x, (int)p.vn.y, (int)p.vn.z };
+        for (int k = 0; k < 3; k++) file << " " << (int)p(k) + 1 << "/" << t[k] + 1 << "/" << n[k] + 1;
+        file << "\n";
+    }
+    return true;
+}
+
+// axis aligned box lo..hi appended to the mesh, 2 polys per face with the face normal
+inline void appendBox(vec3d lo, vec3d hi,
+    std::vector<vec3d>& verts, std::vector<vec3d>& norms, std::vector<vec3d>& uvs, std::vector<polygon>& polys) {
+    int base = verts.size();
+    for (int i = 0; i < 8; i++) verts.emplace_back(i & 1 ? hi.x : lo.x, i & 2 ? hi.y : lo.y, i & 4 ? hi.z : lo.z);
+    int uv = uvs.size();
+    uvs.emplace_back(0, 0, 0);
+    uvs.emplace_back(1, 0, 0);
+    uvs.emplace_back(1, 1, 0);
+    uvs.emplace_back(0, 1, 0);
+
+    // corners of every face (bit 0 - x, 1 - y, 2 - z) and its normal
+    const int faces[6][4] = {
+        { 0, 4, 6, 2 }, { 1, 3, 7, 5 },     // -x, +x
+        { 0, 1, 5, 4 }, { 2, 6, 7, 3 },     // -y, +y
+        { 0, 2, 3, 1 }, { 4, 5, 7, 6 },     // -z, +z
+    };
+    const vec3d normals[6] = { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+    for (int f = 0; f < 6; f++) {
+        norms.push_back(normals[f]);
+        int n = norms.size() - 1;
+        const int* c = faces[f];
+        polys.emplace_back(base + c[0], base + c[1], base + c[2], n, n, n, uv, uv + 1, uv + 2);
+        polys.emplace_back(base + c[0], base + c[2], base + c[3], n, n, n, uv, uv + 2, uv + 3);
+    }
+}
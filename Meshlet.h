@@ -0,0 +1,349 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <cstdint>
+#include <Camera.h>
+
+
+
+// cluster of neighbouring polygons, culled as a whole before any of its verts is transformed
+struct meshlet {
+    std::vector<int> tris;      // idxes in polys
+    std::vector<int> verts;     // unique vert idxes used by tris
+    vec3d center;               // bounding sphere
+    float radius = 0;
+    vec3d axis;                 // normal cone: every poly normal is within acos(coneCos) of axis
+    float coneCos = -1;         // <= 0 -> the cone is too wide, never backface culled
+    float coneSin = 0;
+};
+
+constexpr size_t meshletMaxTris = 128;
+constexpr size_t meshletMaxVerts = 96;
+constexpr size_t meshletMinTris = 64;       // smaller meshlets are merged into a neighbour
+constexpr float meshletMinCos = 0.5f;       // polys of a meshlet are within ~60 deg of its first one
+constexpr float meshletMergeCos = 0.5f;     // a scrap merged into a full meshlet keeps its cone within ~60 deg
+
+struct cullStats {
+    size_t meshlets = 0;
+    size_t frustumCulled = 0;
+    size_t coneCulled = 0;
+    size_t tris = 0;
+    size_t trisCulled = 0;
+};
+
+// normal the renderer uses for backface test of the poly
+inline vec3d meshletNormal(const std::vector<vec3d>& norms, polygon& p) {
+    vec3d n = norms[(int)p.vn.x];
+    return n.normalize();
+}
+
+// sphere and cone of m from the current verts and norms
+inline void updateMeshletBounds(meshlet& m, const std::vector<vec3d>& verts, const std::vector<vec3d>& norms, std::vector<polygon>& polys) {
+    vec3d lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (int v : m.verts) {
+        const vec3d& p = verts[v];
+        lo = vec3d(std::min(lo.x, p.x), std::min(lo.y, p.y), std::min(lo.z, p.z));
+        hi = vec3d(std::max(hi.x, p.x), std::max(hi.y, p.y), std::max(hi.z, p.z));
+    }
+    m.center = (lo + hi) / 2;
+    m.radius = 0;
+    for (int v : m.verts) m.radius = std::max(m.radius, dist(m.center, verts[v]));
+
+    vec3d sum;
+    for (int t : m.tris) sum = sum + meshletNormal(norms, polys[t]);
+    m.coneCos = -1;
+    m.coneSin = 0;
+    if (sum.normEuc() < 1e-6f) return;
+    m.axis = sum.normalize();
+    float minCos = 1;
+    for (int t : m.tris) minCos = std::min(minCos, dot(meshletNormal(norms, polys[t]), m.axis));
+    m.coneCos = minCos;
+    m.coneSin = sqrt(std::max(0.0f, 1 - minCos * minCos));
+}
+
+// greedy clustering: a meshlet grows from a seed poly through polys sharing verts with it,
+// taking only polys within acos(meshletMinCos) of the seed's normal (so the cone stays narrow),
+// preferring the ones closest to it and that share more verts
+// meshlets that end up with less than meshletMinTris polys are merged into a neighbour with room
+// as long as the merged cone stays cullable
+inline std::vector<meshlet> buildMeshlets(const std::vector<vec3d>& verts, const std::vector<vec3d>& norms, std::vector<polygon>& polys) {
+    std::vector<std::vector<int>> vertTris(verts.size());
+    for (size_t t = 0; t < polys.size(); t++) {
+        for (int k = 0; k < 3; k++) vertTris[(int)polys[t](k)].push_back(t);
+    }
+
+    std::vector<meshlet> ans;
+    std::vector<char> used(polys.size(), 0);
+    std::vector<int> owner(verts.size(), -1); // meshlet the vert was last added to
+
+    for (size_t seed = 0; seed < polys.size(); seed++) {
+        if (used[seed]) continue;
+        int id = ans.size();
+        meshlet m;
+        vec3d seedNormal = meshletNormal(norms, polys[seed]);
+        std::vector<int> frontier = { (int)seed };
+
+        while (!frontier.empty() && m.tris.size() < meshletMaxTris) {
+            // best candidate of the frontier
+            size_t best = 0;
+            float bestScore = -FLT_MAX;
+            for (size_t i = 0; i < frontier.size(); i++) {
+                polygon& p = polys[frontier[i]];
+                float score = 0;
+                for (int k = 0; k < 3; k++) score += owner[(int)p(k)] == id;
+                score += 4 * dot(meshletNormal(norms, p), seedNormal);
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = i;
+                }
+            }
+            int t = frontier[best];
+            frontier[best] = frontier.back();
+            frontier.pop_back();
+            if (used[t]) continue;
+
+            polygon& p = polys[t];
+            if (dot(meshletNormal(norms, p), seedNormal) < meshletMinCos) continue;
+            size_t newVerts = 0;
+            for (int k = 0; k < 3; k++) newVerts += owner[(int)p(k)] != id;
+            if (m.verts.size() + newVerts > meshletMaxVerts) continue;
+
+            used[t] = 1;
+            m.tris.push_back(t);
+            for (int k = 0; k < 3; k++) {
+                int v = p(k);
+                if (owner[v] == id) continue;
+                owner[v] = id;
+                m.verts.push_back(v);
+                for (int n : vertTris[v]) {
+                    if (!used[n]) frontier.push_back(n);
+                }
+            }
+        }
+        updateMeshletBounds(m, verts, norms, polys);
+        ans.push_back(m);
+    }
+
+    // scraps (smallest first) into the neighbour with room that keeps the narrowest cone
+    std::vector<std::vector<int>> vertMeshlets(verts.size());
+    for (size_t i = 0; i < ans.size(); i++) {
+        for (int v : ans[i].verts) vertMeshlets[v].push_back(i);
+    }
+    std::vector<int> order(ans.size());
+    for (size_t i = 0; i < ans.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return ans[a].tris.size() < ans[b].tris.size(); });
+    std::vector<char> merged(ans.size(), 0);
+    std::vector<int> stamp(verts.size(), -1);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i : order) {
+            meshlet& scrap = ans[i];
+            if (merged[i] || scrap.tris.size() >= meshletMinTris) continue;
+            for (int v : scrap.verts) stamp[v] = i;
+
+            int best = -1;
+            float bestCos = -FLT_MAX;
+            for (int v : scrap.verts) {
+                for (int j : vertMeshlets[v]) {
+                    if (j == i || merged[j]) continue;
+                    const meshlet& m = ans[j];
+                    if (scrap.tris.size() + m.tris.size() > meshletMaxTris) continue;
+                    size_t shared = 0;
+                    for (int w : m.verts) shared += stamp[w] == i;
+                    if (scrap.verts.size() + m.verts.size() - shared > meshletMaxVerts) continue;
+                    // cone of the merged meshlet
+                    vec3d sum;
+                    for (int t : scrap.tris) sum = sum + meshletNormal(norms, polys[t]);
+                    for (int t : m.tris) sum = sum + meshletNormal(norms, polys[t]);
+                    if (sum.normEuc() < 1e-6f) continue;
+                    vec3d axis = sum.normalize();
+                    float c = 1;
+                    for (int t : scrap.tris) c = std::min(c, dot(meshletNormal(norms, polys[t]), axis));
+                    for (int t : m.tris) c = std::min(c, dot(meshletNormal(norms, polys[t]), axis));
+                    if (pass == 0 && c < meshletMergeCos) continue;
+                    // scraps that fit nowhere else: into another scrap, if it stays cullable
+                    if (pass == 1 && (c <= 0 || m.tris.size() >= meshletMinTris)) continue;
+                    if (c > bestCos) {
+                        bestCos = c;
+                        best = j;
+                    }
+                }
+            }
+            if (best < 0) continue;
+
+            meshlet& m = ans[best];
+            for (int w : m.verts) stamp[w] = -1;
+            for (int v : scrap.verts) {
+                if (stamp[v] != i) continue;  // already in m
+                m.verts.push_back(v);
+                vertMeshlets[v].push_back(best);
+            }
+            m.tris.insert(m.tris.end(), scrap.tris.begin(), scrap.tris.end());
+            updateMeshletBounds(m, verts, norms, polys);
+            merged[i] = 1;
+        }
+    }
+    std::vector<meshlet> kept;
+    for (size_t i = 0; i < ans.size(); i++) {
+        if (!merged[i]) kept.push_back(ans[i]);
+    }
+    return kept;
+}
+
+// FNV-1a over the verts, norms and the v / vn idxes of the polys (what the meshlets are built from)
+inline uint64_t meshHash(const std::vector<vec3d>& verts, const std::vector<vec3d>& norms, const std::vector<polygon>& polys) {
+    uint64_t h = 14695981039346656037ull;
+    auto add = [&](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            h ^= bytes[i];
+            h *= 1099511628211ull;
+        }
+    };
+    for (auto& v : verts) {
+        float xyz[3] = { v.x, v.y, v.z };
+        add(xyz, sizeof(xyz));
+    }
+    for (auto& n : norms) {
+        float xyz[3] = { n.x, n.y, n.z };
+        add(xyz, sizeof(xyz));
+    }
+    for (auto& p : polys) {
+        int32_t idx[6] = { (int32_t)p.v.x, (int32_t)p.v.y, (int32_t)p.v.z, (int32_t)p.vn.x, (int32_t)p.vn.y, (int32_t)p.vn.z };
+        add(idx, sizeof(idx));
+    }
+    return h;
+}
+
+// text file next to the mesh:
+// meshlets <count> <polys> <verts> <hash> <maxTris> <maxVerts> <minTris> <minCos> <mergeCos>
+// m cx cy cz radius ax ay az coneCos coneSin
+// t <n> idxes...
+// v <n> idxes...
+inline bool saveMeshlets(const std::string& path, const std::vector<meshlet>& meshlets,
+    const std::vector<vec3d>& verts, const std::vector<vec3d>& norms, const std::vector<polygon>& polys) {
+    std::ofstream file(path);
+    if (!file.is_open()) return false;
+    file.precision(9); // floats survive the round trip exactly, bounds stay conservative
+    file << "meshlets " << meshlets.size() << " " << polys.size() << " " << verts.size() << " " << meshHash(verts, norms, polys) << " "
+        << meshletMaxTris << " " << meshletMaxVerts << " " << meshletMinTris << " " << meshletMinCos << " " << meshletMergeCos << "\n";
+    for (auto& m : meshlets) {
+        file << "m " << m.center.x << " " << m.center.y << " " << m.center.z << " " << m.radius << " "
+            << m.axis.x << " " << m.axis.y << " " << m.axis.z << " " << m.coneCos << " " << m.coneSin << "\n";
+        file << "t " << m.tris.size();
+        for (int t : m.tris) file << " " << t;
+        file << "\nv " << m.verts.size();
+        for (int v : m.verts) file << " " << v;
+        file << "\n";
+    }
+    return true;
+}
+
+// false if there is no file, it was built for another mesh / other limits or it is broken
+// (idxes out of range, a poly in no meshlet or in several of them)
+inline bool loadMeshlets(const std::string& path, std::vector<meshlet>& meshlets,
+    const std::vector<vec3d>& verts, const std::vector<vec3d>& norms, const std::vector<polygon>& polys) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    std::string type;
+    size_t count, polyCount, vertCount, maxTris, maxVerts, minTris;
+    uint64_t hash;
+    float minCos, mergeCos;
+    file >> type >> count >> polyCount >> vertCount >> hash >> maxTris >> maxVerts >> minTris >> minCos >> mergeCos;
+    if (!file || type != "meshlets" || polyCount != polys.size() || vertCount != verts.size() ||
+        maxTris != meshletMaxTris || maxVerts != meshletMaxVerts || minTris != meshletMinTris || minCos != meshletMinCos || mergeCos != meshletMergeCos ||
+        count > polys.size() || hash != meshHash(verts, norms, polys)) return false;
+
+    std::vector<meshlet> ans(count);
+    std::vector<char> covered(polys.size(), 0);
+    for (auto& m : ans) {
+        size_t n;
+        file >> type >> m.center.x >> m.center.y >> m.center.z >> m.radius
+            >> m.axis.x >> m.axis.y >> m.axis.z >> m.coneCos >> m.coneSin;
+        file >> type >> n;
+        if (!file || n > maxTris) return false;
+        m.tris.resize(n);
+        for (auto& t : m.tris) {
+            file >> t;
+            if (!file || t < 0 || (size_t)t >= polys.size() || covered[t]) return false;
+            covered[t] = 1;
+        }
+        file >> type >> n;
+        if (!file || n > maxVerts) return false;
+        m.verts.resize(n);
+        for (auto& v : m.verts) {
+            file >> v;
+            if (!file || v < 0 || (size_t)v >= verts.size()) return false;
+        }
+    }
+    for (char c : covered) {
+        if (!c) return false;
+    }
+    meshlets = ans;
+    return true;
+}
+
+// meshlets from <objPath>.meshlets, built and saved there if missing or stale
+inline std::vector<meshlet> loadOrBuildMeshlets(const std::string& objPath, const std::vector<vec3d>& verts,
+    const std::vector<vec3d>& norms, std::vector<polygon>& polys) {
+    std::vector<meshlet> ans;
+    std::string path = objPath + ".meshlets";
+    if (loadMeshlets(path, ans, verts, norms, polys)) return ans;
+
+    ans = buildMeshlets(verts, norms, polys);
+    if (!saveMeshlets(path, ans, verts, norms, polys))
+        std::cerr << "meshlets cannot be saved to " << path << std::endl;
+    return ans;
+}
+
+// every poly of m faces away from camPos (same test as the per-poly one in draw(), made conservative by the sphere)
+inline bool meshletBackfacing(const meshlet& m, vec3d camPos) {
+    if (m.coneCos <= 0) return false;
+    vec3d d = camPos * -1 + m.center;
+    float along = dot(d, m.axis);
+    float side = sqrt(std::max(0.0f, dot(d, d) - along * along));
+    // |d| * cos(angle(d, axis) + cone angle) > radius
+    return along * m.coneCos - side * m.coneSin > m.radius;
+}
+
+// bounding sphere is fully behind cam or outside of one of the side planes
+// halfW, halfH: half of the screen size divided by the projection scale (tan of the half fov)
+inline bool meshletOutsideFrustum(const meshlet& m, Camera& cam, float halfW, float halfH) {
+    vec3d c = applyCamera(m.center, cam);
+    if (c.z + m.radius <= 0) return true;
+
+    float lenW = sqrt(1 + halfW * halfW);
+    float lenH = sqrt(1 + halfH * halfH);
+    if ((c.x - halfW * c.z) / lenW > m.radius) return true;
+    if ((-c.x - halfW * c.z) / lenW > m.radius) return true;
+    if ((c.y - halfH * c.z) / lenH > m.radius) return true;
+    if ((-c.y - halfH * c.z) / lenH > m.radius) return true;
+    return false;
+}
+
+// idxes of the meshlets that survive frustum and cone culling (visible: any vector of int)
+template <class Idxes>
+inline void cullMeshlets(const std::vector<meshlet>& meshlets, Camera& cam, float halfW, float halfH,
+    Idxes& visible, cullStats* stats = nullptr) {
+    visible.clear();
+    for (size_t i = 0; i < meshlets.size(); i++) {
+        const meshlet& m = meshlets[i];
+        bool outside = meshletOutsideFrustum(m, cam, halfW, halfH);
+        bool backfacing = !outside && meshletBackfacing(m, cam.pos);
+        if (stats) {
+            stats->meshlets++;
+            stats->tris += m.tris.size();
+            stats->frustumCulled += outside;
+            stats->coneCulled += backfacing;
+            if (outside || backfacing) stats->trisCulled += m.tris.size();
+        }
+        if (!outside && !backfacing) visible.push_back(i);
+    }
+}
@@ -0,0 +1,296 @@
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <OBJparser.h>
+#include <Math3D.h>
+#include <Camera.h>
+#include <MeshGen.h>
+
+using namespace std;
+
+
+
+// microbenchmarks of the math / parser kernels, run without a window
+// Microbench3D [--out results.json] [--baseline old.json] [--threshold 0.1] [--filter name] [--quick]
+// results (ns per element, summary over samples) go to stdout and to json,
+// with a baseline every kernel is compared to it and the exit code is 1 if something got slower
+
+struct benchOptions {
+    string out = "microbench.json";
+    string baseline;
+    string filter;
+    double threshold = 0.1;     // slower by more than 10% (and more than the noise) is a regression
+    int samples = 15;           // max samples per benchmark
+    int minSamples = 5;
+    double minSampleMs = 2;     // a sample repeats the kernel until it takes at least that
+    double maxBenchMs = 1500;   // fewer samples for slow kernels
+    bool quick = false;
+};
+
+struct benchResult {
+    string name;
+    size_t size = 0;            // elements per pass
+    size_t reps = 0;            // passes per sample
+    size_t samples = 0;
+    // ns per element
+    double mean = 0, median = 0, stddev = 0, min = 0, max = 0;
+};
+
+// results are consumed through it, so the compiler cannot drop the kernels
+volatile float sink;
+
+double msSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void summarize(benchResult& r, vector<double> ns) {
+    sort(ns.begin(), ns.end());
+    r.samples = ns.size();
+    r.min = ns.front();
+    r.max = ns.back();
+    r.median = ns.size() % 2 ? ns[ns.size() / 2] : (ns[ns.size() / 2 - 1] + ns[ns.size() / 2]) / 2;
+    r.mean = 0;
+    for (double x : ns) r.mean += x;
+    r.mean /= ns.size();
+    r.stddev = 0;
+    for (double x : ns) r.stddev += (x - r.mean) * (x - r.mean);
+    r.stddev = ns.size() > 1 ? sqrt(r.stddev / (ns.size() - 1)) : 0;
+}
+
+// pass() runs the kernel once over all `size` elements
+template <class F>
+bool runBench(vector<benchResult>& results, const benchOptions& opt, const string& name, size_t size, F pass) {
+    if (!opt.filter.empty() && name.find(opt.filter) == string::npos) return false;
+
+    pass(); // warm-up (caches, page faults)
+    auto start = chrono::steady_clock::now();
+    pass();
+    double once = max(msSince(start), 1e-6);
+
+    benchResult r;
+    r.name = name;
+    r.size = size;
+    r.reps = max<size_t>(1, (size_t)ceil(opt.minSampleMs / once));
+    int samples = clamp((int)(opt.maxBenchMs / (once * r.reps)), opt.minSamples, opt.samples);
+
+    vector<double> ns;
+    for (int s = 0; s < samples; s++) {
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < r.reps; i++) pass();
+        ns.push_back(msSince(start) * 1e6 / ((double)r.reps * size));
+    }
+    summarize(r, ns);
+    results.push_back(r);
+    cout << "  " << name << " [" << size << "]  median " << r.median << " ns  (mean " << r.mean
+        << ", sd " << r.stddev << ", min " << r.min << ", max " << r.max << ", " << r.samples << "x" << r.reps << ")\n";
+    return true;
+}
+
+// random vectors in [-100, 100]^3, the same for every run
+vector<vec3d> randomVecs(size_t n, unsigned seed) {
+    mt19937 gen(seed);
+    uniform_real_distribution<float> d(-100.0f, 100.0f);
+    vector<vec3d> ans(n);
+    for (auto& v : ans) v = vec3d(d(gen), d(gen), d(gen));
+    return ans;
+}
+
+void benchMath(vector<benchResult>& results, const benchOptions& opt, const vector<size_t>& sizes) {
+    Camera cam({ 50, 100, 50 });
+    cam.yaw = 37;
+    cam.pitch = -12;
+    cam.updateVectors();
+    vec3d ang = vec3d(10, 20, 30).rad();
+
+    for (size_t n : sizes) {
+        vector<vec3d> a = randomVecs(n, 1), b = randomVecs(n, 2);
+        vector<vec3d> out(n);
+
+        runBench(results, opt, "vec3d arithmetic", n, [&]() {
+            for (size_t i = 0; i < n; i++) out[i] = (a[i] + b[i] * 0.5f - a[i]) / 3.0f;
+            sink = out[n - 1].x;
+        });
+        runBench(results, opt, "vec3d normalize", n, [&]() {
+            for (size_t i = 0; i < n; i++) out[i] = a[i].normalize();
+            sink = out[n - 1].x;
+        });
+        runBench(results, opt, "applyCamera", n, [&]() {
+            for (size_t i = 0; i < n; i++) out[i] = applyCamera(a[i], cam);
+            sink = out[n - 1].x;
+        });
+        runBench(results, opt, "rotateVector", n, [&]() {
+            for (size_t i = 0; i < n; i++) out[i] = a[i].rotateVector(ang);
+            sink = out[n - 1].x;
+        });
+        runBench(results, opt, "cosVecAngle", n, [&]() {
+            float sum = 0;
+            for (size_t i = 0; i < n; i++) sum += cosVecAngle(a[i], b[i]);
+            sink = sum;
+        });
+    }
+}
+
+void benchParser(vector<benchResult>& results, const benchOptions& opt, const vector<size_t>& polyCounts) {
+    filesystem::path dir = filesystem::temp_directory_path();
+    for (size_t count : polyCounts) {
+        vector<vec3d> verts, norms, uvs;
+        vector<polygon> polys;
+        generateSphere(count, 10.0f, verts, norms, uvs, polys);
+        size_t n = polys.size();
+
+        // face tokens as loadOBJ() hands them to writePolygon()
+        for (bool withUV : { true, false }) {
+            vector<vector<string>> faces(n);
+            for (size_t i = 0; i < n; i++) {
+                for (int k = 0; k < 3; k++) {
+                    string v = to_string((int)polys[i](k) + 1);
+                    string vn = to_string((int)polys[i].vn.x + 1);
+                    faces[i].push_back(withUV ? v + "/" + v + "/" + vn : v + "//" + vn);
+                }
+            }
+            runBench(results, opt, withUV ? "writePolygon v/vt/vn" : "writePolygon v//vn", n, [&]() {
+                float sum = 0;
+                for (auto& f : faces) sum += writePolygon(f).v.z;
+                sink = sum;
+            });
+        }
+
+        string path = (dir / ("microbench_sphere_" + to_string(n) + ".obj")).string();
+        if (!saveOBJ(path, verts, norms, uvs, polys)) {
+            cerr << "cannot write " << path << "\n";
+            continue;
+        }
+        runBench(results, opt, "loadOBJ", n, [&]() {
+            vector<vec3d> v, vn, vt;
+            vector<polygon> p;
+            loadOBJ(path, v, vn, vt, p);
+            sink = p.size();
+        });
+        filesystem::remove(path);
+    }
+}
+
+void saveResults(const string& path, const vector<benchResult>& results) {
+    ofstream file(path);
+    if (!file.is_open()) {
+        cerr << "cannot write " << path << "\n";
+        return;
+    }
+    file.precision(6);
+    file << "{\n  \"unit\": \"ns/element\",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const benchResult& r = results[i];
+        file << "    { \"name\": \"" << r.name << "\", \"size\": " << r.size << ", \"reps\": " << r.reps
+            << ", \"samples\": " << r.samples << ", \"mean\": " << r.mean << ", \"median\": " << r.median
+            << ", \"stddev\": " << r.stddev << ", \"min\": " << r.min << ", \"max\": " << r.max << " }"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+}
+
+// value of "key": in one flat json object (no nesting, as written by saveResults())
+string jsonField(const string& object, const string& key) {
+    size_t pos = object.find("\"" + key + "\"");
+    if (pos == string::npos) return "";
+    pos = object.find(':', pos);
+    if (pos == string::npos) return "";
+    pos = object.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == string::npos) return "";
+    if (object[pos] == '"') return object.substr(pos + 1, object.find('"', pos + 1) - pos - 1);
+    size_t end = object.find_first_of(",} \t\r\n", pos);
+    return object.substr(pos, end - pos);
+}
+
+// baseline saved by saveResults() (any formatting), keyed by "name/size"
+map<string, benchResult> loadResults(const string& path) {
+    map<string, benchResult> ans;
+    ifstream file(path);
+    string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    size_t start = 0;
+    while ((start = text.find('{', start + 1)) != string::npos) {
+        size_t end = text.find('}', start);
+        if (end == string::npos) break;
+        string object = text.substr(start, end - start + 1);
+        string size = jsonField(object, "size"), median = jsonField(object, "median"), stddev = jsonField(object, "stddev");
+        if (size.empty() || median.empty() || stddev.empty()) continue;
+        benchResult r;
+        r.name = jsonField(object, "name");
+        r.size = stoull(size);
+        r.median = stod(median);
+        r.stddev = stod(stddev);
+        ans[r.name + "/" + to_string(r.size)] = r;
+    }
+    return ans;
+}
+
+// number of regressions: slower by more than the threshold and by more than 2 combined sds
+int compareResults(const vector<benchResult>& results, const map<string, benchResult>& baseline, double threshold) {
+    int regressions = 0;
+    cout << "compared to the baseline (median):\n";
+    for (auto& r : results) {
+        auto it = baseline.find(r.name + "/" + to_string(r.size));
+        if (it == baseline.end()) {
+            cout << "  " << r.name << " [" << r.size << "]  new\n";
+            continue;
+        }
+        const benchResult& b = it->second;
+        double change = (r.median - b.median) / b.median;
+        double noise = 2 * sqrt(r.stddev * r.stddev + b.stddev * b.stddev);
+        const char* verdict = "";
+        if (change > threshold && r.median - b.median > noise) {
+            verdict = "  REGRESSION";
+            regressions++;
+        }
+        else if (change < -threshold && b.median - r.median > noise) verdict = "  faster";
+        cout << "  " << r.name << " [" << r.size << "]  " << b.median << " -> " << r.median << " ns  ("
+            << (change >= 0 ? "+" : "") << change * 100 << "%)" << verdict << "\n";
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    benchOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) opt.out = argv[++i];
+        else if (arg == "--baseline" && hasValue) opt.baseline = argv[++i];
+        else if (arg == "--threshold" && hasValue) opt.threshold = stod(argv[++i]);
+        else if (arg == "--filter" && hasValue) opt.filter = argv[++i];
+        else if (arg == "--quick") opt.quick = true;
+        else {
+            cerr << "usage: " << argv[0] << " [--out file.json] [--baseline file.json] [--threshold 0.1] [--filter name] [--quick]\n";
+            return 2;
+        }
+    }
+    if (opt.quick) {
+        opt.samples = opt.minSamples;
+        opt.maxBenchMs = 200;
+    }
+
+    vector<benchResult> results;
+    cout << "math kernels, ns per vector:\n";
+    benchMath(results, opt, opt.quick ? vector<size_t>{ 1 << 10, 1 << 16 } : vector<size_t>{ 1 << 10, 1 << 14, 1 << 18, 1 << 21 });
+    cout << "parser, ns per polygon:\n";
+    benchParser(results, opt, opt.quick ? vector<size_t>{ 1 << 10, 1 << 14 } : vector<size_t>{ 1 << 10, 1 << 14, 1 << 18 });
+
+    saveResults(opt.out, results);
+    cout << "results saved to " << opt.out << "\n";
+
+    if (opt.baseline.empty()) return 0;
+    map<string, benchResult> baseline = loadResults(opt.baseline);
+    if (baseline.empty()) {
+        cerr << "no results in the baseline " << opt.baseline << "\n";
+        return 2;
+    }
+    int regressions = compareResults(results, baseline, opt.threshold);
+    cout << regressions << " regression(s)\n";
+    return regressions ? 1 : 0;
+}
@@ -5,6 +5,9 @@
 #include <sstream>
 #include <vector>
 #include <string>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
 
 
 
@@ -91,15 +94,20 @@ struct vec3d {
 struct polygon {
     vec3d v; //  
     vec3d vn; //  
+    vec3d vt; // texture coords idxes
     sf::Color color;
 
-    polygon(int v1 = 0, int v2 = 0, int v3 = 0, int n1 = 0, int n2 = 0, int n3 = 0, sf::Color _color = sf::Color(255, 0, 208)) {
+    polygon(int v1 = 0, int v2 = 0, int v3 = 0, int n1 = 0, int n2 = 0, int n3 = 0,
+        int t1 = 0, int t2 = 0, int t3 = 0, sf::Color _color = sf::Color(255, 0, 208)) {
         v.x = v1;
         v.y = v2;
         v.z = v3;
         vn.x = n1;
         vn.y = n2;
         vn.z = n3;
+        vt.x = t1;
+        vt.y = t2;
+        vt.z = t3;
         color = _color;
     }
 
@@ -117,24 +125,35 @@ struct polygon {
 polygon writePolygon(std::vector<std::string> parts) {
     polygon face;
     for (size_t i = 0; i < 3 && i < parts.size(); i++) {
-        std::replace(parts[i].begin(), parts[i].end(), '/', ' ');
+        // split "v/vt/vn" by hand, so "v//vn" does not shift vn into vt
+        int idx[3] = { -1, -1, -1 };
         std::istringstream viss(parts[i]);
-
-        int vIdx = -1, vtIdx = -1, vnIdx = -1;
-        viss >> vIdx >> vtIdx >> vnIdx;
+        std::string token;
+        for (int k = 0; k < 3 && std::getline(viss, token, '/'); k++) {
+            // not a number or out of int range -> the index is treated as missing
+            if (token.empty()) continue;
+            char* end = nullptr;
+            errno = 0;
+            long n = std::strtol(token.c_str(), &end, 10);
+            if (*end == '\0' && errno == 0 && n >= INT_MIN && n <= INT_MAX) idx[k] = (int)n;
+        }
+        int vIdx = idx[0], vtIdx = idx[1], vnIdx = idx[2];
 
         //   
         if (i == 0) {
             face.v.x = vIdx > 0 ? vIdx - 1 : 0;
             face.vn.x = vnIdx > 0 ? vnIdx - 1 : 0;
+            face.vt.x = vtIdx > 0 ? vtIdx - 1 : 0;
         }
         if (i == 1) {
             face.v.y = vIdx > 0 ? vIdx - 1 : 0;
             face.vn.y = vnIdx > 0 ? vnIdx - 1 : 0;
+            face.vt.y = vtIdx > 0 ? vtIdx - 1 : 0;
         }
         if (i == 2) {
             face.v.z = vIdx > 0 ? vIdx - 1 : 0;
             face.vn.z = vnIdx > 0 ? vnIdx - 1 : 0;
+            face.vt.z = vtIdx > 0 ? vtIdx - 1 : 0;
         }
     }
     return face;
@@ -143,6 +162,7 @@ polygon writePolygon(std::vector<std::string> parts) {
 bool loadOBJ(const std::string& path,
     std::vector<vec3d>& vertices,
     std::vector<vec3d>& normals,
+    std::vector<vec3d>& texcoords,
     std::vector<polygon>& faces) {
 
     std::ifstream file(path);
@@ -169,6 +189,12 @@ bool loadOBJ(const std::string& path,
             iss >> n.x >> n.y >> n.z;
             normals.push_back(n);
         }
+        // texture coords (z is unused)
+        else if (type == "vt") {
+            vec3d t;
+            iss >> t.x >> t.y;
+            texcoords.push_back(t);
+        }
         //  
         else if (type == "f") {
             std::vector<std::string> parts;  //    "1//2", "3/4/5"  ..
@@ -176,6 +202,7 @@ bool loadOBJ(const std::string& path,
             //    
             std::string part;
             while (iss >> part) {
+                if (part[0] == '#') break;  // trailing comment
                 parts.push_back(part);
             }
 
@@ -199,4 +226,13 @@ bool loadOBJ(const std::string& path,
 
     file.close();
     return true;
+}
+
+// loading without texture coords
+bool loadOBJ(const std::string& path,
+    std::vector<vec3d>& vertices,
+    std::vector<vec3d>& normals,
+    std::vector<polygon>& faces) {
+    std::vector<vec3d> texcoords;
+    return loadOBJ(path, vertices, normals, texcoords, faces);
 }
\ No newline at end of file
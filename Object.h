@@ -0,0 +1,307 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <OBJparser.h>
+#include <Meshlet.h>
+#include <Texture.h>
+
+
+
+class obj {
+public:
+    std::vector<vec3d> verts;       // vertices
+    std::vector<vec3d> norms;       // normals
+    std::vector<polygon> polys;     // polygons
+    std::vector<vec3d> uvs;         // texture coords (u, v)
+    std::vector<meshlet> meshlets;  // poly clusters, bounds kept in global coords like verts
+    const texture* tex = nullptr;   // texture for the software path
+    bool occluder = false;          // drawn into the occlusion buffer (for low poly closed meshes)
+    bool castsShadow = true;        // drawn into the shadow map
+    bool dynamic = false;           // moves all the time, kept in the dynamic shadow layer
+    vec3d pos;                      // center pos
+    vec3d front;                    // local Z
+    vec3d right;                    // local X
+    vec3d up;                       // local Y
+    float mass;                     // mass
+    vec3d vel;                      // velocity
+    vec3d acc;                      // acceleration
+    vec3d angVel;                   // angular velocity
+    vec3d angAcc;                   // angular acceleration
+    float scale;                    // scale multiplier
+    int id;                         // identity, kept by copies (lighting cache key)
+    unsigned version = 0;           // bumped on every transform
+
+    obj(std::vector<vec3d> _verts, std::vector<vec3d> _norms, std::vector<polygon> _polys, float _mass = 0, float _scale = 1) :
+        verts(_verts), norms(_norms), polys(_polys), mass(_mass), scale(_scale), front({ 0, 0, -1 }), right({ 1, 0, 0 }), up({ 0, 1, 0 }) {
+        static int nextId = 0;
+        id = nextId++;
+        setupPos(); setupScale();
+    }
+
+    obj(std::vector<vec3d> _verts, std::vector<vec3d> _norms, std::vector<vec3d> _uvs, std::vector<polygon> _polys, float _mass = 0, float _scale = 1) :
+        obj(_verts, _norms, _polys, _mass, _scale) {
+        uvs = _uvs;
+    }
+
+    // meshlets built for the raw (unscaled) mesh, call right after construction
+    void setMeshlets(const std::vector<meshlet>& m) {
+        meshlets = m;
+        for (auto& ml : meshlets) {
+            ml.center = ml.center * scale;
+            ml.radius *= scale;
+        }
+    }
+
+    void moveMeshlets(vec3d d) {
+        for (auto& m : meshlets) m.center = m.center + d;
+    }
+
+    void rotateMeshlets(vec3d ang, vec3d center) {
+        for (auto& m : meshlets) {
+            m.center = center + (m.center - center).rotateVector(ang);
+            m.axis = m.axis.rotateVector(ang);
+        }
+    }
+
+    void setupPos() {
+        float c = 0.0f;
+        for (auto& v : verts) {
+            pos.x += v.x;
+            pos.y += v.y;
+            pos.z += v.z;
+            c++;
+        }
+        pos.x /= c;
+        pos.y /= c;
+        pos.z /= c;
+    }
+
+    void setupScale() {
+        version++;
+        pos = pos * scale;
+        for (auto& v : verts) {
+            v.x *= scale;
+            v.y *= scale;
+            v.z *= scale;
+        }
+    }
+
+    void setPos(float x, float y, float z) {
+        version++;
+        vec3d posOld = pos;
+        for (auto& v : verts) {
+            pos.x = x;
+            pos.y = y;
+            pos.z = z;
+            v = v + pos - posOld;
+        }
+        moveMeshlets(pos - posOld);
+    }
+
+    // move object (ignoring normals cause why should not we)
+    void moveForward(float a) {
+        version++;
+        pos = pos - front * a;
+        for (auto& v : verts) {
+            v = v - front * a;
+        }
+        moveMeshlets(front * -a);
+    }
+    void moveBackward(float a) {
+        version++;
+        pos = pos + front * a;
+        for (auto& v : verts) {
+            v = v + front * a;
+        }
+        moveMeshlets(front * a);
+    }
+    void moveRight(float a) {
+        version++;
+        pos = pos + right * a;
+        for (auto& v : verts) {
+            v = v + right * a;
+        }
+        moveMeshlets(right * a);
+    }
+    void moveLeft(float a) {
+        version++;
+        pos = pos - right * a;
+        for (auto& v : verts) {
+            v = v - right * a;
+        }
+        moveMeshlets(right * -a);
+    }
+    void moveUp(float a) {
+        version++;
+        pos = pos + up * a;
+        for (auto& v : verts) {
+            v = v + up * a;
+        }
+        moveMeshlets(up * a);
+    }
+    void moveDown(float a) {
+        version++;
+        pos = pos - up * a;
+        for (auto& v : verts) {
+            v = v - up * a;
+        }
+        moveMeshlets(up * -a);
+    }
+
+    // GLOBAL
+    void moveUpGlobal(float a) {
+        version++;
+        pos.y += a;
+        for (auto& v : verts) {
+            v.y = v.y + a;
+        }
+        moveMeshlets(vec3d(0, a, 0));
+    }
+    void moveDownGlobal(float a) {
+        version++;
+        pos.y -= a;
+        for (auto& v : verts) {
+            v.y = v.y - a;
+        }
+        moveMeshlets(vec3d(0, -a, 0));
+    }
+
+    void movecustom(vec3d& vec, float a) {
+        version++;
+        pos = pos - vec * a;
+        for (auto& v : verts) {
+            v = v - vec * a;
+        }
+        moveMeshlets(vec * -a);
+    }
+
+    void rotate(vec3d ang) { // rotate object
+        if (ang == vec3d()) return; // nothing to do, keep cached lighting valid
+        version++;
+        vec3d center = pos; // object center
+
+        // rotate around center
+        for (auto& v : verts) {
+            // get local coords of v
+            vec3d local = v - center;
+
+            // apply rotation
+            local = local.rotateVector(ang);
+
+            // get global coords of rotated v
+            v = center + local;
+        }
+
+        // rotate normals
+        for (auto& n : norms) {
+            n = n.rotateVector(ang);
+        }
+        rotateMeshlets(ang, center);
+
+        // update local axises
+        front = front.rotateVector(ang).normalize();
+        right = right.rotateVector(ang).normalize();
+        up = up.rotateVector(ang).normalize();
+    }
+
+    void rotateAroundLocalFront(float angle) {
+        version++;
+        vec3d ang = front * -angle;
+
+        vec3d center = pos; // object center
+
+        // rotate around center
+        for (auto& v : verts) {
+            // get local coords of v
+            vec3d local = v - center;
+
+            // apply rotation
+            local = local.rotateVector(ang);
+
+            // get global coords of rotated v
+            v = center + local;
+        }
+
+        // rotate normals
+        for (auto& n : norms) {
+            n = n.rotateVector(ang);
+        }
+        rotateMeshlets(ang, center);
+
+        // update local axises
+        front = front.rotateVector(ang).normalize();
+        right = right.rotateVector(ang).normalize();
+        up = up.rotateVector(ang).normalize();
+    }
+
+    void rotateCustom(vec3d ang, vec3d point) {
+        version++;
+        vec3d center = point;
+
+        // rotate around point
+        for (auto& v : verts) {
+            // get local coords of v
+            vec3d local = v - center;
+
+            // apply rotation
+            local = local.rotateVector(ang);
+
+            // get global coords of rotated v
+            v = center + local;
+        }
+
+        // rotate normals
+        for (auto& n : norms) {
+            n = n.rotateVector(ang);
+        }
+        rotateMeshlets(ang, center);
+
+        // update local axises
+        front = front.rotateVector(ang).normalize();
+        right = right.rotateVector(ang).normalize();
+        up = up.rotateVector(ang).normalize();
+    }
+    //void draw(sf::RenderWindow& w, Camera& cam, std::vector<sf::Color> colors);
+};
+
+class light {
+public:
+    vec3d pos; // center pos
+    vec3d front; // local Z
+    vec3d right; // local X
+    vec3d up; // local Y
+    float density = 100;
+
+    light(vec3d _pos) :
+        pos(_pos), front({ 0, 0, -1 }), right({ 1, 0, 0 }), up({ 0, 1, 0 }) {}
+
+    void setPos(float x, float y, float z) {
+        vec3d p = { x, y, z };
+        pos = p;
+    }
+
+    void setDensity(float d) {
+        density = d;
+    }
+
+    // move light
+    void moveForward(float a) {
+        pos = pos - front * a;
+    }
+    void moveBackward(float a) {
+        pos = pos + front * a;
+    }
+    void moveRight(float a) {
+        pos = pos + right * a;
+    }
+    void moveLeft(float a) {
+        pos = pos - right * a;
+    }
+    void moveUp(float a) {
+        pos = pos + up * a;
+    }
+    void moveDown(float a) {
+        pos = pos - up * a;
+    }
+};
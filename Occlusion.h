@@ -0,0 +1,350 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <Camera.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_SSE 1
+#else
+#define OCCLUSION_SSE 0
+#endif
+
+
+
+struct occlusionStats {
+    size_t occluders = 0;
+    size_t occluderTris = 0;        // rasterized into the buffer
+    size_t objects = 0;             // tested
+    size_t objectsCulled = 0;
+    size_t clusters = 0;            // meshlets tested
+    size_t clustersCulled = 0;
+};
+
+// software occlusion culling:
+// selected occluders are rasterized into a small depth buffer (1/z like framebuffer, 0 is empty),
+// a pyramid keeps the farthest and the nearest depth of every 2x2 block of the level below,
+// then bounding boxes are tested against the level where they cover at most 4x4 texels
+// for culling a pixel is covered only when it is fully inside an occluder, with the farthest depth of the occluder over it,
+// so culling never changes the image; a shadow map samples depth at pixel centers like rasterTriangle() instead
+class occlusionBuffer {
+public:
+    int width, height;      // level 0, width is a multiple of 4
+    float focal;            // pixels per unit at z = 1 (200 at the window size)
+    float nearZ = 0.1f;     // boxes reaching closer than it are always visible
+    bool conservative = true;   // coverage and depth over the whole pixel, false: at its center
+    mutable occlusionStats stats;
+
+    struct level {
+        int w = 0, h = 0;
+        std::vector<float> farthest;    // min 1/z of the block
+        std::vector<float> nearest;     // max 1/z of the block
+    };
+    std::vector<level> levels;          // 0 is the buffer itself
+
+    occlusionBuffer(int w = 320, int h = 180, float _focal = 40) :
+        width((w + 3) & ~3), height(h), focal(_focal), originX(w / 2.0f), originY(h / 2.0f) {
+        for (int lw = width, lh = height;; lw = (lw + 1) / 2, lh = (lh + 1) / 2) {
+            level l;
+            l.w = lw;
+            l.h = lh;
+            l.farthest.assign((size_t)lw * lh, 0.0f);
+            l.nearest.assign((size_t)lw * lh, 0.0f);
+            levels.push_back(l);
+            if (lw == 1 && lh == 1) break;
+        }
+    }
+
+    // new frame seen from cam: empty buffer, stats reset
+    void begin(const Camera& _cam) {
+        cam = _cam;
+        stats = occlusionStats();
+        std::fill(levels[0].farthest.begin(), levels[0].farthest.end(), 0.0f);
+    }
+
+    // conservative: pairs of coplanar triangles forming a convex quad (boxes, planes) go in as the quad,
+    // otherwise the pixels along its diagonal would be covered by neither of them
+    void addOccluder(const std::vector<vec3d>& verts, std::vector<polygon>& polys) {
+        stats.occluders++;
+        for (size_t i = 0; i < polys.size(); i++) {
+            vec3d quad[4];
+            if (conservative && i + 1 < polys.size() && quadOf(verts, polys[i], polys[i + 1], quad)) {
+                addPolygon(quad, 4);
+                i++;
+            }
+            else {
+                vec3d tri[3] = { verts[(int)polys[i](0)], verts[(int)polys[i](1)], verts[(int)polys[i](2)] };
+                addPolygon(tri, 3);
+            }
+        }
+    }
+
+    void addTriangle(vec3d a, vec3d b, vec3d c) {
+        vec3d tri[3] = { a, b, c };
+        addPolygon(tri, 3);
+    }
+
+    // convex planar polygon of count <= 4 verts
+    // both sides are drawn, closed occluders keep their front through the depth test
+    // clipped by the near plane (a caster crossing the edge of a shadow map face has verts behind it,
+    // dropping it would let light leak along the seams)
+    void addPolygon(const vec3d* verts, int count) {
+        vec3d in[4];
+        for (int i = 0; i < count; i++) in[i] = applyCamera(verts[i], cam);
+        vec3d clipped[5];
+        int n = 0;
+        for (int i = 0; i < count; i++) {
+            vec3d p = in[i], q = in[(i + 1) % count];
+            bool pIn = p.z >= nearZ, qIn = q.z >= nearZ;
+            if (pIn) clipped[n++] = p;
+            if (pIn != qIn) clipped[n++] = p + (q - p) * ((nearZ - p.z) / (q.z - p.z));
+        }
+        if (n < 3) return;
+
+        screenPoint s[5];
+        for (int i = 0; i < n; i++) toScreen(clipped[i], s[i]);
+        fillPolygon(s, n);
+    }
+
+    // after all occluders are in
+    void buildPyramid() {
+        level& base = levels[0];
+        base.nearest = base.farthest;
+        for (size_t i = 1; i < levels.size(); i++) {
+            const level& src = levels[i - 1];
+            level& dst = levels[i];
+            for (int y = 0; y < dst.h; y++) {
+                // odd sizes: the last row / column is paired with itself
+                const size_t r0 = (size_t)(2 * y) * src.w;
+                const size_t r1 = (size_t)std::min(2 * y + 1, src.h - 1) * src.w;
+                int x = 0;
+#if OCCLUSION_SSE
+                // 4 output texels from 8 of each of the 2 source rows
+                for (; 2 * x + 8 <= src.w; x += 4) {
+                    for (int k = 0; k < 2; k++) {
+                        const float* a = (k ? src.nearest : src.farthest).data();
+                        __m128 lo = _mm_loadu_ps(a + r0 + 2 * x), hi = _mm_loadu_ps(a + r0 + 2 * x + 4);
+                        __m128 lo1 = _mm_loadu_ps(a + r1 + 2 * x), hi1 = _mm_loadu_ps(a + r1 + 2 * x + 4);
+                        lo = k ? _mm_max_ps(lo, lo1) : _mm_min_ps(lo, lo1);
+                        hi = k ? _mm_max_ps(hi, hi1) : _mm_min_ps(hi, hi1);
+                        __m128 even = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+                        __m128 odd = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+                        float* out = (k ? dst.nearest : dst.farthest).data() + (size_t)y * dst.w + x;
+                        _mm_storeu_ps(out, k ? _mm_max_ps(even, odd) : _mm_min_ps(even, odd));
+                    }
+                }
+#endif
+                for (; x < dst.w; x++) {
+                    size_t c0 = 2 * x, c1 = std::min(2 * x + 1, src.w - 1);
+                    dst.farthest[(size_t)y * dst.w + x] = std::min({ src.farthest[r0 + c0], src.farthest[r0 + c1],
+                        src.farthest[r1 + c0], src.farthest[r1 + c1] });
+                    dst.nearest[(size_t)y * dst.w + x] = std::max({ src.nearest[r0 + c0], src.nearest[r0 + c1],
+                        src.nearest[r1 + c0], src.nearest[r1 + c1] });
+                }
+            }
+        }
+    }
+
+    // global axis aligned box lo..hi is behind the occluders everywhere it can be seen
+    bool boxOccluded(vec3d lo, vec3d hi) const {
+        // screen rect and the nearest depth of the box (z is linear, so its extremes are at corners)
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, boxNearest = 0;
+        for (int i = 0; i < 8; i++) {
+            vec3d corner(i & 1 ? hi.x : lo.x, i & 2 ? hi.y : lo.y, i & 4 ? hi.z : lo.z);
+            screenPoint s;
+            if (!project(corner, s)) return false;
+            minX = std::min(minX, s.x);
+            minY = std::min(minY, s.y);
+            maxX = std::max(maxX, s.x);
+            maxY = std::max(maxY, s.y);
+            boxNearest = std::max(boxNearest, s.invZ);
+        }
+        int x0 = std::max(0, (int)std::floor(minX)), y0 = std::max(0, (int)std::floor(minY));
+        int x1 = std::min(width - 1, (int)std::floor(maxX)), y1 = std::min(height - 1, (int)std::floor(maxY));
+        if (x0 > x1 || y0 > y1) return false; // off screen, frustum culling is not done here
+
+        // level where the rect spans at most 4x4 texels
+        size_t l = 0;
+        while (l + 1 < levels.size() && ((x1 >> l) - (x0 >> l) >= 4 || (y1 >> l) - (y0 >> l) >= 4)) l++;
+
+        // quick accept: the box is nearer than every occluder in a coarser block around it
+        size_t coarse = std::min(l + 2, levels.size() - 1);
+        const level& c = levels[coarse];
+        float occluderNearest = 0;
+        for (int y = y0 >> coarse; y <= y1 >> coarse; y++) {
+            for (int x = x0 >> coarse; x <= x1 >> coarse; x++) occluderNearest = std::max(occluderNearest, c.nearest[(size_t)y * c.w + x]);
+        }
+        if (boxNearest >= occluderNearest) return false;
+
+        const level& t = levels[l];
+        for (int y = y0 >> l; y <= y1 >> l; y++) {
+            for (int x = x0 >> l; x <= x1 >> l; x++) {
+                if (t.farthest[(size_t)y * t.w + x] <= boxNearest) return false;
+            }
+        }
+        return true;
+    }
+
+    bool sphereOccluded(vec3d center, float radius) const {
+        vec3d r(radius, radius, radius);
+        return boxOccluded(center - r, center + r);
+    }
+
+    // the same tests, counted in stats
+    bool objectOccluded(vec3d lo, vec3d hi) const {
+        bool ans = boxOccluded(lo, hi);
+        stats.objects++;
+        stats.objectsCulled += ans;
+        return ans;
+    }
+
+    bool clusterOccluded(vec3d center, float radius) const {
+        bool ans = sphereOccluded(center, radius);
+        stats.clusters++;
+        stats.clustersCulled += ans;
+        return ans;
+    }
+
+    // 1/z of p and of the nearest occluder at its pixel, false if p is behind the near plane or off the buffer
+    // (up to a pixel off is clamped, so points on the edge between shadow map faces are not lost)
+    bool sample(vec3d p, float& invZ, float& occluderInvZ) const {
+        screenPoint s;
+        if (!project(p, s)) return false;
+        if (s.x < -1 || s.y < -1 || s.x > width + 1 || s.y > height + 1) return false;
+        int x = std::clamp((int)std::floor(s.x), 0, width - 1), y = std::clamp((int)std::floor(s.y), 0, height - 1);
+        invZ = s.invZ;
+        occluderInvZ = levels[0].farthest[(size_t)y * width + x];
+        return true;
+    }
+
+private:
+    struct screenPoint {
+        float x, y, invZ;
+    };
+    float originX, originY;     // projection center (width may be padded)
+    mutable Camera cam;
+
+    // same projection as draw(), scaled to the buffer
+    bool project(vec3d v, screenPoint& s) const {
+        vec3d t = applyCamera(v, cam);
+        if (t.z < nearZ) return false;
+        toScreen(t, s);
+        return true;
+    }
+
+    // camera space point in front of the near plane -> buffer
+    void toScreen(vec3d t, screenPoint& s) const {
+        s.invZ = 1.0f / t.z;
+        s.x = t.x * s.invZ * focal + originX;
+        s.y = -t.y * s.invZ * focal + originY;
+    }
+
+    // a, b (sharing an edge, in the order of appendBox()) as the quad a0 a1 a2 b-other, if it is planar and convex
+    static bool quadOf(const std::vector<vec3d>& verts, polygon& a, polygon& b, vec3d* quad) {
+        int ia[3] = { (int)a(0), (int)a(1), (int)a(2) }, ib[3] = { (int)b(0), (int)b(1), (int)b(2) };
+        // b = (a0, a2, d): the fan of a quad a0 a1 a2 d
+        if (ib[0] != ia[0] || ib[1] != ia[2] || ib[2] == ia[1]) return false;
+        for (int i = 0; i < 3; i++) quad[i] = verts[ia[i]];
+        quad[3] = verts[ib[2]];
+        vec3d n = vecProd(quad[1] - quad[0], quad[2] - quad[0]);
+        float len = n.normEuc();
+        if (len < 1e-12f) return false;
+        for (int i = 0; i < 4; i++) {
+            vec3d e0 = quad[(i + 1) % 4] - quad[i], e1 = quad[(i + 2) % 4] - quad[(i + 1) % 4];
+            // every turn to the same side (convex) and d in the plane of a
+            if (dot(vecProd(e0, e1), n) <= 0) return false;
+        }
+        return std::fabs(dot(quad[3] - quad[0], n)) <= 1e-5f * len * (dist(quad[0], quad[3]) + 1);
+    }
+
+    // convex polygon s[0..n-1] into level 0, max of 1/z per pixel
+    // a pixel is in when it is on the inner side of every edge: e = base + dx * x + dy * y >= 0 at its center,
+    // conservative: at its corner furthest out (center e - (|dx| + |dy|) / 2), and it gets the farthest 1/z over it
+    void fillPolygon(const screenPoint* s, int n) {
+        // 1/z is linear on the screen: plane from the largest triangle of the fan
+        int k = 1;
+        float area = 0;
+        for (int i = 1; i + 1 < n; i++) {
+            float a = (s[i].x - s[0].x) * (s[i + 1].y - s[0].y) - (s[i].y - s[0].y) * (s[i + 1].x - s[0].x);
+            if (std::fabs(a) > std::fabs(area)) {
+                area = a;
+                k = i;
+            }
+        }
+        if (std::fabs(area) < 1e-6f) return;
+
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+        for (int i = 0; i < n; i++) {
+            minX = std::min(minX, s[i].x);
+            minY = std::min(minY, s[i].y);
+            maxX = std::max(maxX, s[i].x);
+            maxY = std::max(maxY, s[i].y);
+        }
+        int x0 = std::max(0, (int)std::floor(minX)) & ~3;
+        int y0 = std::max(0, (int)std::floor(minY));
+        int x1 = std::min(width - 1, (int)std::ceil(maxX));
+        int y1 = std::min(height - 1, (int)std::ceil(maxY));
+        if (x0 > x1 || y0 > y1) return;
+        stats.occluderTris += n - 2;
+
+        // edges, oriented so that the inside is >= 0
+        float sign = area > 0 ? 1.0f : -1.0f;
+        float edgeBase[5], edgeDx[5], edgeDy[5];
+        for (int i = 0; i < n; i++) {
+            const screenPoint& p = s[i];
+            const screenPoint& q = s[(i + 1) % n];
+            edgeDx[i] = -(q.y - p.y) * sign;
+            edgeDy[i] = (q.x - p.x) * sign;
+            edgeBase[i] = -(edgeDx[i] * p.x + edgeDy[i] * p.y);
+            if (conservative) edgeBase[i] -= 0.5f * (std::fabs(edgeDx[i]) + std::fabs(edgeDy[i]));
+        }
+
+        // 1/z = zBase + zdx * x + zdy * y
+        const screenPoint& a = s[0];
+        const screenPoint& b = s[k];
+        const screenPoint& c = s[k + 1];
+        float invArea = 1.0f / area;
+        float zdx = ((b.invZ - a.invZ) * (c.y - a.y) - (c.invZ - a.invZ) * (b.y - a.y)) * invArea;
+        float zdy = ((c.invZ - a.invZ) * (b.x - a.x) - (b.invZ - a.invZ) * (c.x - a.x)) * invArea;
+        float zBase = a.invZ - zdx * a.x - zdy * a.y;
+        if (conservative) zBase -= 0.5f * (std::fabs(zdx) + std::fabs(zdy));
+
+        std::vector<float>& depth = levels[0].farthest;
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            float* row = depth.data() + (size_t)y * width;
+#if OCCLUSION_SSE
+            const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 zero = _mm_setzero_ps();
+            __m128 rowE[5], dE[5];
+            for (int i = 0; i < n; i++) {
+                rowE[i] = _mm_set1_ps(edgeBase[i] + edgeDy[i] * py);
+                dE[i] = _mm_set1_ps(edgeDx[i]);
+            }
+            __m128 rowZ = _mm_set1_ps(zBase + zdy * py), dZ = _mm_set1_ps(zdx);
+            for (int x = x0; x <= x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(rowE[0], _mm_mul_ps(dE[0], px)), zero);
+                for (int i = 1; i < n; i++) inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(rowE[i], _mm_mul_ps(dE[i], px)), zero));
+                if (!_mm_movemask_ps(inside)) continue;
+                __m128 z = _mm_add_ps(rowZ, _mm_mul_ps(dZ, px));
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 closer = _mm_max_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, old)));
+            }
+#else
+            for (int x = x0; x <= x1; x++) {
+                float px = x + 0.5f;
+                bool inside = true;
+                for (int i = 0; i < n && inside; i++) inside = edgeBase[i] + edgeDx[i] * px + edgeDy[i] * py >= 0;
+                if (!inside) continue;
+                row[x] = std::max(row[x], zBase + zdx * px + zdy * py);
+            }
+#endif
+        }
+    }
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include "Texture.h"
+#include "FrameArena.h"
+
+
+
+// screen rectangle [x0, x1) x [y0, y1)
+struct rect {
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    rect() {}
+    rect(int _x0, int _y0, int _x1, int _y1) :
+        x0(_x0), y0(_y0), x1(_x1), y1(_y1) {}
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+    size_t area() const { return empty() ? 0 : (size_t)(x1 - x0) * (y1 - y0); }
+
+    bool overlaps(const rect& r) const {
+        return !empty() && !r.empty() && x0 < r.x1 && r.x0 < x1 && y0 < r.y1 && r.y0 < y1;
+    }
+
+    rect intersect(const rect& r) const {
+        return rect(std::max(x0, r.x0), std::max(y0, r.y0), std::min(x1, r.x1), std::min(y1, r.y1));
+    }
+};
+
+// software color + depth buffer, presented through a streaming sf::Texture
+class framebuffer {
+public:
+    int width, height;
+    std::vector<uint32_t> color;    // 0xAABBGGRR
+    std::vector<float> depth;       // 1/z, bigger is closer, 0 is "nothing here"
+    rect scissor;                   // rasterTriangle() writes only inside of it
+
+    framebuffer(int w = 0, int h = 0) {
+        resize(w, h);
+    }
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        color.assign((size_t)w * h, 0);
+        depth.assign((size_t)w * h, 0.0f);
+        resetScissor();
+    }
+
+    void resetScissor() {
+        scissor = rect(0, 0, width, height);
+    }
+
+    void clear(sf::Color c) {
+        std::fill(color.begin(), color.end(), packColor(c));
+        std::fill(depth.begin(), depth.end(), 0.0f);
+    }
+
+    void clear(sf::Color c, rect r) {
+        r = r.intersect(rect(0, 0, width, height));
+        if (r.empty()) return;
+        uint32_t packed = packColor(c);
+        for (int y = r.y0; y < r.y1; y++) {
+            size_t row = (size_t)y * width;
+            std::fill(color.begin() + row + r.x0, color.begin() + row + r.x1, packed);
+            std::fill(depth.begin() + row + r.x0, depth.begin() + row + r.x1, 0.0f);
+        }
+    }
+
+    const sf::Uint8* pixels() const {
+        return reinterpret_cast<const sf::Uint8*>(color.data());
+    }
+};
+
+// screen space vertex, attributes are already divided by z
+struct rasterVertex {
+    float x, y;     // screen coords
+    float invZ;     // 1/z
+    float uz, vz;   // u/z, v/z
+};
+
+// log2 of a positive float from its exponent bits + linear mantissa, off by < 0.09
+// (good enough for picking the mip level, and much cheaper than std::log2 once per quad)
+inline float fastLog2(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    uint32_t oneToTwo = (bits & 0x007FFFFF) | 0x3F800000;
+    float mantissa;
+    std::memcpy(&mantissa, &oneToTwo, sizeof(mantissa));
+    return (float)((int)(bits >> 23) - 127) + (mantissa - 1.0f);
+}
+
+struct rasterStats {
+    size_t triangles = 0;   // counted by the caller, once per triangle however many rects it is split into
+    size_t pixels = 0;      // pixels that passed the depth test and were written
+    size_t texels = 0;      // of them textured, one bilinear sample (4 fetches) each
+};
+
+// fills triangle a-b-c in 2x2 pixel quads with perspective correct uv
+// the 4 uvs of a quad give the screen space derivatives, so the mip level is picked once per quad
+// tex == nullptr -> flat color; mipmapping == false -> always sample level 0
+// shade scales the texel color (lambert factor, already clamped by the caller)
+inline void rasterTriangle(framebuffer& fb, const rasterVertex& a, const rasterVertex& b, const rasterVertex& c,
+    const texture* tex, sf::Color flat, float shade, bool mipmapping, rasterStats& stats) {
+
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::fabs(area) < 1e-6f) return;
+    float invArea = 1.0f / area;
+
+    // bounding box, aligned to the quad grid
+    const rect& clip = fb.scissor;
+    int clipX = std::max(0, clip.x0), clipY = std::max(0, clip.y0);
+    int minX = std::max(clipX, (int)std::floor(std::min({ a.x, b.x, c.x }))) & ~1;
+    int minY = std::max(clipY, (int)std::floor(std::min({ a.y, b.y, c.y }))) & ~1;
+    int maxX = std::min(std::min(fb.width, clip.x1) - 1, (int)std::ceil(std::max({ a.x, b.x, c.x })));
+    int maxY = std::min(std::min(fb.height, clip.y1) - 1, (int)std::ceil(std::max({ a.y, b.y, c.y })));
+    if (minX > maxX || minY > maxY) return;
+
+    // flat color * shade, used when there is no texture
+    uint32_t flatShaded = packRGBA(
+        (uint8_t)std::min(255.0f, flat.r * shade),
+        (uint8_t)std::min(255.0f, flat.g * shade),
+        (uint8_t)std::min(255.0f, flat.b * shade));
+    int shadeFixed = (int)(std::min(shade, 255.0f) * 256.0f);
+
+    float texW = tex ? (float)tex->width() : 0.0f;
+    float texH = tex ? (float)tex->height() : 0.0f;
+
+    for (int y = minY; y <= maxY; y += 2) {
+        for (int x = minX; x <= maxX; x += 2) {
+            // barycentrics of the 4 pixel centers of the quad
+            float w0[4], w1[4], w2[4];
+            int mask = 0;
+            for (int q = 0; q < 4; q++) {
+                float px = x + (q & 1) + 0.5f;
+                float py = y + (q >> 1) + 0.5f;
+                w0[q] = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) * invArea;
+                w1[q] = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) * invArea;
+                w2[q] = 1.0f - w0[q] - w1[q];
+                if (w0[q] >= 0 && w1[q] >= 0 && w2[q] >= 0) mask |= 1 << q;
+            }
+            if (!mask) continue;
+
+            float invZ[4], u[4], v[4];
+            for (int q = 0; q < 4; q++) {
+                invZ[q] = w0[q] * a.invZ + w1[q] * b.invZ + w2[q] * c.invZ;
+                float z = 1.0f / invZ[q];
+                u[q] = (w0[q] * a.uz + w1[q] * b.uz + w2[q] * c.uz) * z;
+                v[q] = (w0[q] * a.vz + w1[q] * b.vz + w2[q] * c.vz) * z;
+            }
+
+            // lod from the quad derivatives (helper pixels outside the triangle count too)
+            float lod = 0.0f;
+            if (tex && mipmapping) {
+                float dudx = (u[1] - u[0]) * texW, dvdx = (v[1] - v[0]) * texH;
+                float dudy = (u[2] - u[0]) * texW, dvdy = (v[2] - v[0]) * texH;
+                float rho2 = std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+                lod = 0.5f * fastLog2(std::max(rho2, 1e-12f));
+            }
+
+            for (int q = 0; q < 4; q++) {
+                if (!(mask & (1 << q))) continue;
+                int px = x + (q & 1);
+                int py = y + (q >> 1);
+                if (px < clipX || py < clipY || px > maxX || py > maxY) continue;
+                size_t idx = (size_t)py * fb.width + px;
+                if (invZ[q] <= fb.depth[idx]) continue;
+                fb.depth[idx] = invZ[q];
+
+                if (tex) {
+                    uint32_t t = tex->sample(u[q], v[q], lod);
+                    stats.texels++;
+                    uint32_t ans = 0xFF000000;
+                    for (int s = 0; s < 24; s += 8) {
+                        int ch = (((t >> s) & 0xFF) * shadeFixed) >> 8;
+                        ans |= (uint32_t)std::min(255, ch) << s;
+                    }
+                    fb.color[idx] = ans;
+                }
+                else fb.color[idx] = flatShaded;
+                stats.pixels++;
+            }
+        }
+    }
+}
+
+// screen split into 32x32 tiles, a tile is dirty when something in it has to be redrawn
+class tileGrid {
+public:
+    static constexpr int tileSize = 32;
+    int width = 0, height = 0;      // in pixels
+    int tilesX = 0, tilesY = 0;
+    std::vector<char> dirty;
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        tilesX = (w + tileSize - 1) / tileSize;
+        tilesY = (h + tileSize - 1) / tileSize;
+        dirty.assign((size_t)tilesX * tilesY, 0);
+    }
+
+    void clear() {
+        std::fill(dirty.begin(), dirty.end(), 0);
+    }
+
+    void mark(rect r) {
+        r = r.intersect(rect(0, 0, width, height));
+        if (r.empty()) return;
+        for (int ty = r.y0 / tileSize; ty <= (r.y1 - 1) / tileSize; ty++) {
+            for (int tx = r.x0 / tileSize; tx <= (r.x1 - 1) / tileSize; tx++) {
+                dirty[(size_t)ty * tilesX + tx] = 1;
+            }
+        }
+    }
+
+    size_t count() const {
+        return std::count(dirty.begin(), dirty.end(), 1);
+    }
+
+    // dirty tiles merged into disjoint rectangles (into ans, its memory is reused):
+    // runs of dirty tiles in a row, a run is glued to the one right above it if they span the same columns
+    void rects(std::vector<rect>& ans) const {
+        ans.clear();
+        frameVector<size_t> prevRow; // idxes in ans of the runs of the previous row
+        frameVector<size_t> row;
+        for (int ty = 0; ty < tilesY; ty++) {
+            row.clear();
+            for (int tx = 0; tx < tilesX; tx++) {
+                if (!dirty[(size_t)ty * tilesX + tx]) continue;
+                int start = tx;
+                while (tx < tilesX && dirty[(size_t)ty * tilesX + tx]) tx++;
+
+                rect r(start * tileSize, ty * tileSize,
+                    std::min(tx * tileSize, width), std::min((ty + 1) * tileSize, height));
+                bool glued = false;
+                for (size_t i : prevRow) {
+                    if (ans[i].x0 == r.x0 && ans[i].x1 == r.x1 && ans[i].y1 == r.y0) {
+                        ans[i].y1 = r.y1;
+                        row.push_back(i);
+                        glued = true;
+                        break;
+                    }
+                }
+                if (!glued) {
+                    row.push_back(ans.size());
+                    ans.push_back(r);
+                }
+            }
+            prevRow.swap(row);
+        }
+    }
+};
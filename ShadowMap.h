@@ -0,0 +1,141 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <Occlusion.h>
+#include <FrameArena.h>
+
+
+
+struct shadowStats {
+    // current frame
+    bool staticRendered = false;
+    bool dynamicRendered = false;
+    size_t tris = 0;            // caster tris rasterized
+    float ms = 0;               // update() time
+    size_t lookups = 0;
+    // since start
+    size_t staticRenders = 0;
+    size_t dynamicRenders = 0;
+    size_t frames = 0;
+};
+
+// a sphere (center, radius) can be in the shadow of the caster sphere: it overlaps the cone from the light
+// around the caster and reaches behind the caster's near side (conservative)
+inline bool mayBeShadowed(vec3d lightPos, vec3d casterCenter, float casterRadius, vec3d center, float radius) {
+    vec3d toCaster = casterCenter - lightPos, toSphere = center - lightPos;
+    float casterDist = dist(casterCenter, lightPos), sphereDist = dist(center, lightPos);
+    if (casterDist <= casterRadius || sphereDist <= radius) return true;
+    if (sphereDist + radius < casterDist - casterRadius) return false;
+    float cosAngle = std::clamp(dot(toCaster, toSphere) / (casterDist * sphereDist), -1.0f, 1.0f);
+    return std::acos(cosAngle) <= std::asin(casterRadius / casterDist) + std::asin(radius / sphereDist);
+}
+
+// cube depth map of a point light: 6 faces of 90 deg, each an occlusionBuffer seen from the light
+// casters are split into 2 cached layers: static ones (re-rendered only when one of them or the light moves)
+// and dynamic ones (re-rendered when one of them or the light moves), a point is lit if neither layer hides it
+// objects need: verts, polys, id, version (bumped on every transform), castsShadow, dynamic
+class shadowMap {
+public:
+    int size;                   // of a face
+    float depthBias = 0.02f;    // relative, so a surface does not shadow itself
+    float normalOffset = 1.5f;  // in texels at the point's distance, along the surface normal
+    mutable shadowStats stats;
+
+    shadowMap(int _size = 256) :
+        size(_size), layers{ layer(_size), layer(_size) } {}
+
+    // re-renders the layers whose casters or light changed
+    template <class Obj>
+    void update(std::vector<Obj>& objects, vec3d lightPos) {
+        auto start = std::chrono::steady_clock::now();
+        stats.staticRendered = stats.dynamicRendered = false;
+        stats.tris = 0;
+        stats.lookups = 0;
+        stats.frames++;
+
+        for (int dynamic = 0; dynamic < 2; dynamic++) {
+            layer& l = layers[dynamic];
+            // what the layer would be rendered from now
+            frameVector<caster> casters;
+            for (auto& o : objects) {
+                if (o.castsShadow && o.dynamic == (bool)dynamic) casters.push_back({ o.id, o.version });
+            }
+            if (l.valid && l.lightPos == lightPos && casters.size() == l.casters.size() &&
+                std::equal(casters.begin(), casters.end(), l.casters.begin())) continue;
+
+            l.valid = true;
+            l.lightPos = lightPos;
+            l.casters.assign(casters.begin(), casters.end());
+            for (int f = 0; f < 6; f++) {
+                l.faces[f].begin(faceCamera(f, lightPos));
+                for (auto& o : objects) {
+                    if (o.castsShadow && o.dynamic == (bool)dynamic) l.faces[f].addOccluder(o.verts, o.polys);
+                }
+                stats.tris += l.faces[f].stats.occluderTris;
+            }
+            if (dynamic) {
+                stats.dynamicRendered = true;
+                stats.dynamicRenders++;
+            }
+            else {
+                stats.staticRendered = true;
+                stats.staticRenders++;
+            }
+        }
+        stats.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // point p of a surface with the (unit) normal is not hidden from the light by any caster
+    bool lit(vec3d p, vec3d normal) const {
+        stats.lookups++;
+        for (const layer& l : layers) {
+            if (!l.valid) continue;
+            // pushed off the surface by the texel size there, so the surface does not shadow itself
+            float texel = dist(p, l.lightPos) * 2.0f / size;
+            vec3d q = p + normal * (texel * normalOffset);
+            vec3d d = q - l.lightPos;
+            float ax = std::fabs(d.x), ay = std::fabs(d.y), az = std::fabs(d.z);
+            int f = ax >= ay && ax >= az ? (d.x > 0 ? 0 : 1) : (ay >= az ? (d.y > 0 ? 2 : 3) : (d.z > 0 ? 4 : 5));
+            float invZ, casterInvZ;
+            if (l.faces[f].sample(q, invZ, casterInvZ) && casterInvZ > invZ * (1 + depthBias)) return false;
+        }
+        return true;
+    }
+
+private:
+    struct caster {
+        int id;
+        unsigned version;
+        bool operator ==(const caster& c) const { return id == c.id && version == c.version; }
+    };
+
+    struct layer {
+        std::vector<occlusionBuffer> faces;
+        std::vector<caster> casters;    // what the faces were rendered from
+        vec3d lightPos;
+        bool valid = false;
+
+        layer(int size) :
+            faces(6, occlusionBuffer(size, size, size / 2.0f)) {
+            for (auto& f : faces) f.conservative = false;   // depth at pixel centers, conservative would leak light at edges
+        }
+    };
+    layer layers[2];            // static, dynamic
+
+    // face f looks along +x, -x, +y, -y, +z, -z (applyCamera() looks along -front)
+    static Camera faceCamera(int f, vec3d lightPos) {
+        static const vec3d dirs[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+        static const vec3d rights[6] = { { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { 1, 0, 0 }, { -1, 0, 0 }, { 1, 0, 0 } };
+        static const vec3d ups[6] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0, 1, 0 }, { 0, 1, 0 } };
+        Camera cam(lightPos);
+        vec3d dir = dirs[f];
+        cam.front = dir * -1;
+        cam.right = rights[f];
+        cam.up = ups[f];
+        return cam;
+    }
+};
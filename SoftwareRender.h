@@ -0,0 +1,311 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <climits>
+#include <cfloat>
+#include <Object.h>
+#include <Raster.h>
+#include <Camera.h>
+#include <Meshlet.h>
+#include <FrameArena.h>
+#include <Occlusion.h>
+#include <ShadowMap.h>
+
+
+
+// window size, the projection (200 px focal length) is defined for it
+constexpr int width = 1600;
+constexpr int height = 900;
+constexpr int centerX = width / 2;
+constexpr int centerY = height / 2;
+
+// lambert factor of the polygon (0 if it faces away from the light), o: obj or sceneMesh
+template <class Mesh>
+inline float lambert(Mesh& o, polygon& p, light& sun) {
+    vec3d normal = o.norms[p.vn.x].normalize();
+    vec3d polyCenter = (o.verts[p(0)] + o.verts[p(1)] + o.verts[p(2)]) / 3;
+    vec3d lightDir = (sun.pos - polyCenter).normalize();
+
+    if (dot(normal, lightDir) < 0.0f) return 0.0f;
+    return cosVecAngle(normal, lightDir) * sun.density / dist(sun.pos, polyCenter);
+}
+
+// polygon center sees the light (always when there are no shadows)
+template <class Mesh>
+inline bool inLight(Mesh& o, polygon& p, const shadowMap* shadows) {
+    if (!shadows) return true;
+    vec3d polyCenter = (o.verts[p(0)] + o.verts[p(1)] + o.verts[p(2)]) / 3;
+    return shadows->lit(polyCenter, o.norms[p.vn.x].normalize());
+}
+
+// per-triangle lambert factors in world space (0 where the shadow map hides the light), kept between frames
+// an object is reshaded only when it was transformed (obj::version), the light moved / changed density,
+// a shadow layer was re-rendered, or the color of a single triangle changed (then only that triangle)
+class lightingCache {
+public:
+    // current frame
+    size_t hits = 0;
+    size_t reshaded = 0;
+    // since start
+    size_t totalHits = 0;
+    size_t totalReshaded = 0;
+
+    void newFrame() {
+        hits = 0;
+        reshaded = 0;
+    }
+
+    float hitRate() const {
+        size_t all = totalHits + totalReshaded;
+        return all ? (float)totalHits / all : 0.0f;
+    }
+
+    // factors for o.polys, colors[firstColor + i] is the color of o.polys[i]
+    // shadows != nullptr -> shadowed polys get 0
+    const std::vector<float>& shade(obj& o, light& sun, const frameVector<sf::Color>& colors, size_t firstColor,
+        const shadowMap* shadows = nullptr) {
+        entry& e = entries[o.id];
+        size_t staticRenders = shadows ? shadows->stats.staticRenders : 0;
+        size_t dynamicRenders = shadows ? shadows->stats.dynamicRenders : 0;
+        bool stale = e.version != o.version || !(e.lightPos == sun.pos) || e.density != sun.density ||
+            e.shadows != shadows || e.staticRenders != staticRenders || e.dynamicRenders != dynamicRenders ||
+            e.shades.size() != o.polys.size();
+        if (stale) {
+            e.version = o.version;
+            e.lightPos = sun.pos;
+            e.density = sun.density;
+            e.shadows = shadows;
+            e.staticRenders = staticRenders;
+            e.dynamicRenders = dynamicRenders;
+            e.shades.resize(o.polys.size());
+            e.colors.resize(o.polys.size());
+        }
+
+        size_t hit = 0;
+        for (size_t i = 0; i < o.polys.size(); i++) {
+            const sf::Color& c = colors[firstColor + i];
+            if (!stale && e.colors[i] == c) {
+                hit++;
+                continue;
+            }
+            e.colors[i] = c;
+            e.shades[i] = lambert(o, o.polys[i], sun);
+            if (e.shades[i] > 0.0f && !inLight(o, o.polys[i], shadows)) e.shades[i] = 0.0f;
+        }
+        hits += hit;
+        reshaded += o.polys.size() - hit;
+        totalHits += hit;
+        totalReshaded += o.polys.size() - hit;
+        return e.shades;
+    }
+
+private:
+    struct entry {
+        unsigned version = UINT_MAX;    // obj::version the shades belong to
+        vec3d lightPos;
+        float density = -1;
+        const shadowMap* shadows = nullptr;
+        size_t staticRenders = 0;       // renders of the shadow map layers the shades saw
+        size_t dynamicRenders = 0;
+        std::vector<float> shades;
+        std::vector<sf::Color> colors;  // material the shades were computed for
+    };
+    std::unordered_map<int, entry> entries;
+};
+
+// polys of o that survive meshlet culling (all of them if o has no meshlets)
+// occlusion != nullptr -> clusters hidden behind the occluders are dropped too
+inline void visiblePolys(obj& o, Camera& cam, float halfW, float halfH, frameVector<int>& polys, cullStats* culling,
+    const occlusionBuffer* occlusion = nullptr) {
+    polys.clear();
+    if (o.meshlets.empty()) {
+        for (size_t i = 0; i < o.polys.size(); i++) polys.push_back(i);
+        return;
+    }
+    frameVector<int> visible;
+    cullMeshlets(o.meshlets, cam, halfW, halfH, visible, culling);
+    for (int m : visible) {
+        if (occlusion && occlusion->clusterOccluded(o.meshlets[m].center, o.meshlets[m].radius)) continue;
+        polys.insert(polys.end(), o.meshlets[m].tris.begin(), o.meshlets[m].tris.end());
+    }
+}
+
+// global bounding box of o (from the meshlet spheres when there are meshlets)
+inline void worldBounds(obj& o, vec3d& lo, vec3d& hi) {
+    lo = vec3d(FLT_MAX, FLT_MAX, FLT_MAX);
+    hi = vec3d(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    auto add = [&](vec3d a, vec3d b) {
+        lo = vec3d(std::min(lo.x, a.x), std::min(lo.y, a.y), std::min(lo.z, a.z));
+        hi = vec3d(std::max(hi.x, b.x), std::max(hi.y, b.y), std::max(hi.z, b.z));
+    };
+    if (o.meshlets.empty()) {
+        for (auto& v : o.verts) add(v, v);
+        return;
+    }
+    for (auto& m : o.meshlets) {
+        vec3d r(m.radius, m.radius, m.radius);
+        add(m.center - r, m.center + r);
+    }
+}
+
+inline bool objectOccluded(obj& o, const occlusionBuffer* occlusion) {
+    if (!occlusion || o.verts.empty()) return false;
+    vec3d lo, hi;
+    worldBounds(o, lo, hi);
+    return occlusion->objectOccluded(lo, hi);
+}
+
+// occluders of the frame into the buffer, before anything is drawn
+inline void buildOcclusion(std::vector<obj>& objects, Camera& cam, occlusionBuffer& occlusion) {
+    occlusion.begin(cam);
+    for (auto& o : objects) {
+        if (o.occluder) occlusion.addOccluder(o.verts, o.polys);
+    }
+    occlusion.buildPyramid();
+}
+
+// perspective proj of a global point to fb, false if it is behind cam
+inline bool projectToScreen(vec3d v, Camera& cam, const framebuffer& fb, rasterVertex& r) {
+    vec3d transformed = applyCamera(v, cam);
+    if (transformed.z <= 0) return false;
+
+    float depth = 1.0f / transformed.z;
+    r.x = transformed.x * depth * 200 * fb.width / width + fb.width / 2;
+    r.y = -transformed.y * depth * 200 * fb.width / width + fb.height / 2;
+    r.invZ = depth;
+    return true;
+}
+
+// pixel rect covering the projected points (inclusive float bounds)
+inline rect pixelBounds(float minX, float minY, float maxX, float maxY, const framebuffer& fb) {
+    if (minX > maxX) return rect();
+    rect ans((int)std::max(-1.0f, std::floor(minX)), (int)std::max(-1.0f, std::floor(minY)),
+        (int)std::min((float)fb.width + 1, std::ceil(maxX)) + 1, (int)std::min((float)fb.height + 1, std::ceil(maxY)) + 1);
+    return ans.intersect(rect(0, 0, fb.width, fb.height));
+}
+
+// screen bounds of the visible verts of o (what drawSoftware() can touch)
+inline rect screenBounds(obj& o, Camera& cam, const framebuffer& fb) {
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    rasterVertex r;
+    for (auto& v : o.verts) {
+        if (!projectToScreen(v, cam, fb, r)) continue;
+        minX = std::min(minX, r.x);
+        minY = std::min(minY, r.y);
+        maxX = std::max(maxX, r.x);
+        maxY = std::max(maxY, r.y);
+    }
+    return pixelBounds(minX, minY, maxX, maxY, fb);
+}
+
+// software path: rasterizing into fb with z-buffer (no sorting needed), textured if o.tex is set
+// bounds != nullptr -> gets screen bounds of what was drawn for free
+// clips != nullptr -> drawn only into these rects (the object is still culled, transformed and shaded once)
+inline void drawSoftware(framebuffer& fb, obj& o, Camera& cam, light& sun, const frameVector<sf::Color>& colors, size_t firstColor, bool mipmapping, rasterStats& stats,
+    lightingCache* cache = nullptr, rect* bounds = nullptr, cullStats* culling = nullptr, const occlusionBuffer* occlusion = nullptr,
+    const shadowMap* shadows = nullptr, const std::vector<rect>* clips = nullptr) {
+    // hidden behind the occluders: not even shaded
+    // (bounds are the whole object, it can be uncovered by an occluder moving away while it stays)
+    if (objectOccluded(o, occlusion)) {
+        if (bounds) *bounds = screenBounds(o, cam, fb);
+        return;
+    }
+    const std::vector<float>* shades = cache ? &cache->shade(o, sun, colors, firstColor, shadows) : nullptr;
+
+    // whole clusters culled first, so their verts are never transformed
+    frameVector<int> polys;
+    float halfW = (float)centerX / 200;
+    float halfH = (fb.height / 2.0f) / (200.0f * fb.width / width);
+    visiblePolys(o, cam, halfW, halfH, polys, culling, occlusion);
+
+    frameVector<rasterVertex> projections(o.verts.size());
+    frameVector<char> visible(o.verts.size(), 0); // 0 - not transformed, 1 - in front of cam, 2 - behind
+
+    // verts translation
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (int i : polys) {
+        for (int k = 0; k < 3; k++) {
+            int v = o.polys[i](k);
+            if (visible[v]) continue;
+            visible[v] = projectToScreen(o.verts[v], cam, fb, projections[v]) ? 1 : 2;
+            if (visible[v] == 1) {
+                minX = std::min(minX, projections[v].x);
+                minY = std::min(minY, projections[v].y);
+                maxX = std::max(maxX, projections[v].x);
+                maxY = std::max(maxY, projections[v].y);
+            }
+        }
+    }
+    if (bounds) *bounds = occlusion ? screenBounds(o, cam, fb) : pixelBounds(minX, minY, maxX, maxY, fb);
+
+    bool textured = o.tex && !o.uvs.empty();
+    for (int i : polys) {
+        auto& p = o.polys[i];
+
+        // if polygon is behind cam
+        if (visible[p(0)] != 1 || visible[p(1)] != 1 || visible[p(2)] != 1) continue;
+
+        // if polygon is out of the scissor (all the dirty rects)
+        const rasterVertex& a = projections[p(0)];
+        const rasterVertex& b = projections[p(1)];
+        const rasterVertex& c = projections[p(2)];
+        float polyX0 = std::min({ a.x, b.x, c.x }), polyX1 = std::max({ a.x, b.x, c.x });
+        float polyY0 = std::min({ a.y, b.y, c.y }), polyY1 = std::max({ a.y, b.y, c.y });
+        auto inRect = [&](const rect& r) {
+            return polyX1 >= r.x0 && polyX0 < r.x1 && polyY1 >= r.y0 && polyY0 < r.y1;
+        };
+        if (clips ? std::none_of(clips->begin(), clips->end(), inRect) : !inRect(fb.scissor)) continue;
+
+        // normal to the current polygon
+        vec3d normal = o.norms[p.vn.x].normalize();
+
+        // vector from poly to cam
+        vec3d polyCenter = (o.verts[p(0)] + o.verts[p(1)] + o.verts[p(2)]) / 3;
+        vec3d viewDir = (cam.pos - polyCenter).normalize();
+
+        // checking visibility through normal
+        if (dot(normal, viewDir) < 0.0f) continue;
+
+        float shade;
+        if (shades) shade = (*shades)[i];
+        else {
+            shade = lambert(o, p, sun);
+            if (shade > 0.0f && !inLight(o, p, shadows)) shade = 0.0f;
+        }
+
+        rasterVertex tri[3];
+        for (int k = 0; k < 3; k++) {
+            tri[k] = projections[p(k)];
+            tri[k].uz = tri[k].vz = 0.0f;
+            if (textured) {
+                int t = k == 0 ? p.vt.x : (k == 1 ? p.vt.y : p.vt.z);
+                // obj v goes up, texture rows go down
+                tri[k].uz = o.uvs[t].x * tri[k].invZ;
+                tri[k].vz = (1.0f - o.uvs[t].y) * tri[k].invZ;
+            }
+        }
+        const texture* tex = textured ? o.tex : nullptr;
+        stats.triangles++;
+        if (!clips) {
+            rasterTriangle(fb, tri[0], tri[1], tri[2], tex, colors[firstColor + i], shade, mipmapping, stats);
+            continue;
+        }
+        for (auto& r : *clips) {
+            if (!inRect(r)) continue;
+            fb.scissor = r;
+            rasterTriangle(fb, tri[0], tri[1], tri[2], tex, colors[firstColor + i], shade, mipmapping, stats);
+        }
+    }
+}
+
+inline void drawSceneSoftware(std::vector<obj>& objects, framebuffer& fb, Camera& cam, light& sun, const frameVector<sf::Color>& colors, bool mipmapping, rasterStats& stats,
+    lightingCache* cache = nullptr, cullStats* culling = nullptr, const occlusionBuffer* occlusion = nullptr, const shadowMap* shadows = nullptr) {
+    size_t globalPolyIdx = 0;
+    for (auto& o : objects) {
+        drawSoftware(fb, o, cam, sun, colors, globalPolyIdx, mipmapping, stats, cache, nullptr, culling, occlusion, shadows);
+        globalPolyIdx += o.polys.size();
+    }
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cmath>
+
+
+
+// texels are packed as 0xAABBGGRR, so a buffer of them is byte-compatible with sf::Texture::update()
+inline uint32_t packRGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+    return (uint32_t)r | ((uint32_t)g << 8) | ((uint32_t)b << 16) | ((uint32_t)a << 24);
+}
+
+inline uint32_t packColor(sf::Color c) {
+    return packRGBA(c.r, c.g, c.b, c.a);
+}
+
+// texture with precomputed mip chain
+// every level is stored in 4x4 tiles (16 texels * 4 bytes = one 64 byte cache line),
+// so texels that are close in 2D are close in memory too
+class texture {
+public:
+    static constexpr int tileBits = 2;
+    static constexpr int tileSize = 1 << tileBits;
+
+    struct level {
+        int w, h;                   // size in texels
+        int tilesX;                 // tiles per row
+        bool pow2;                  // wrap with a mask instead of %
+        std::vector<uint32_t> texels;
+    };
+
+    std::vector<level> mips;        // mips[0] is the full size image
+
+    texture() {}
+
+    texture(const uint32_t* rgba, int w, int h) {
+        create(rgba, w, h);
+    }
+
+    int width() const { return mips.empty() ? 0 : mips[0].w; }
+    int height() const { return mips.empty() ? 0 : mips[0].h; }
+    bool empty() const { return mips.empty(); }
+
+    // linear RGBA image -> tiled level 0 + mip chain down to 1x1
+    void create(const uint32_t* rgba, int w, int h) {
+        mips.clear();
+        mips.push_back(makeLevel(w, h));
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                mips[0].texels[offset(mips[0], x, y)] = rgba[y * w + x];
+            }
+        }
+        buildMips();
+    }
+
+    bool loadFromFile(const std::string& path) {
+        sf::Image img;
+        if (!img.loadFromFile(path)) return false;
+        sf::Vector2u size = img.getSize();
+        create(reinterpret_cast<const uint32_t*>(img.getPixelsPtr()), size.x, size.y);
+        return true;
+    }
+
+    // procedural checkerboard (fallback when there is no image on disk)
+    static texture checker(int size, int cell, sf::Color c1, sf::Color c2) {
+        std::vector<uint32_t> rgba(size * size);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                rgba[y * size + x] = ((x / cell + y / cell) % 2) ? packColor(c1) : packColor(c2);
+            }
+        }
+        return texture(rgba.data(), size, size);
+    }
+
+    // single texel of the level, coords wrap around (repeat)
+    uint32_t fetch(int lvl, int x, int y) const {
+        const level& l = mips[lvl];
+        if (l.pow2) {
+            x &= l.w - 1;
+            y &= l.h - 1;
+        }
+        else {
+            x %= l.w; if (x < 0) x += l.w;
+            y %= l.h; if (y < 0) y += l.h;
+        }
+        return l.texels[offset(l, x, y)];
+    }
+
+    // bilinear sample from the mip level nearest to lod
+    // lod = log2(texels per pixel), <= 0 means magnification
+    uint32_t sample(float u, float v, float lod) const {
+        int lvl = 0;
+        if (lod > 0.0f) {
+            lvl = (int)(lod + 0.5f);
+            if (lvl >= (int)mips.size()) lvl = (int)mips.size() - 1;
+        }
+        const level& l = mips[lvl];
+
+        float fx = u * l.w - 0.5f;
+        float fy = v * l.h - 0.5f;
+        float x0f = std::floor(fx);
+        float y0f = std::floor(fy);
+        int x0 = (int)x0f;
+        int y0 = (int)y0f;
+        // 8 bit weights
+        int wx = (int)((fx - x0f) * 256.0f);
+        int wy = (int)((fy - y0f) * 256.0f);
+
+        uint32_t t00 = fetch(lvl, x0, y0);
+        uint32_t t10 = fetch(lvl, x0 + 1, y0);
+        uint32_t t01 = fetch(lvl, x0, y0 + 1);
+        uint32_t t11 = fetch(lvl, x0 + 1, y0 + 1);
+
+        uint32_t ans = 0;
+        for (int s = 0; s < 32; s += 8) {
+            int c00 = (t00 >> s) & 0xFF, c10 = (t10 >> s) & 0xFF;
+            int c01 = (t01 >> s) & 0xFF, c11 = (t11 >> s) & 0xFF;
+            int top = c00 * (256 - wx) + c10 * wx;
+            int bottom = c01 * (256 - wx) + c11 * wx;
+            int c = (top * (256 - wy) + bottom * wy) >> 16;
+            ans |= (uint32_t)c << s;
+        }
+        return ans;
+    }
+
+private:
+    static level makeLevel(int w, int h) {
+        level l;
+        l.w = w;
+        l.h = h;
+        l.tilesX = (w + tileSize - 1) >> tileBits;
+        l.pow2 = (w & (w - 1)) == 0 && (h & (h - 1)) == 0;
+        int tilesY = (h + tileSize - 1) >> tileBits;
+        l.texels.assign((size_t)l.tilesX * tilesY * tileSize * tileSize, 0);
+        return l;
+    }
+
+    // tile idx * 16 + position inside the tile
+    static size_t offset(const level& l, int x, int y) {
+        size_t tile = (size_t)(y >> tileBits) * l.tilesX + (x >> tileBits);
+        return (tile << (2 * tileBits)) + ((y & (tileSize - 1)) << tileBits) + (x & (tileSize - 1));
+    }
+
+    // 2x2 box filter of the previous level
+    void buildMips() {
+        while (mips.back().w > 1 || mips.back().h > 1) {
+            const level& prev = mips.back();
+            level next = makeLevel(std::max(1, prev.w / 2), std::max(1, prev.h / 2));
+            for (int y = 0; y < next.h; y++) {
+                for (int x = 0; x < next.w; x++) {
+                    int sx = std::min(2 * x, prev.w - 1), sx1 = std::min(2 * x + 1, prev.w - 1);
+                    int sy = std::min(2 * y, prev.h - 1), sy1 = std::min(2 * y + 1, prev.h - 1);
+                    uint32_t t[4] = {
+                        prev.texels[offset(prev, sx, sy)], prev.texels[offset(prev, sx1, sy)],
+                        prev.texels[offset(prev, sx, sy1)], prev.texels[offset(prev, sx1, sy1)]
+                    };
+                    uint32_t ans = 0;
+                    for (int s = 0; s < 32; s += 8) {
+                        uint32_t c = ((t[0] >> s) & 0xFF) + ((t[1] >> s) & 0xFF) + ((t[2] >> s) & 0xFF) + ((t[3] >> s) & 0xFF);
+                        ans |= ((c + 2) / 4) << s;
+                    }
+                    next.texels[offset(next, x, y)] = ans;
+                }
+            }
+            mips.push_back(std::move(next));
+        }
+    }
+};